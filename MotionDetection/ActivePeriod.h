@@ -0,0 +1,175 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2026 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#include "motionDetector.h"
+#include "SmallVector.h"
+
+namespace WPEFramework {
+
+    namespace Plugin {
+
+        // Active period of the motion detectors, in seconds since midnight.
+        // The ranges given by the caller are validated and normalized into a sorted set of
+        // disjoint half-open intervals [start, end): ranges that cross midnight (start > end)
+        // are split in two, overlapping and adjacent ranges are merged. That keeps the
+        // "is detection active at T" question a binary search.
+        class ActivePeriod {
+        public:
+            static constexpr uint32_t SecondsPerDay = 86400;
+            static constexpr uint32_t InlineRanges = 8;
+
+            typedef SmallVector<MOTION_DETECTION_Time_t, InlineRanges> Ranges;
+
+        public:
+            ActivePeriod() = default;
+            ActivePeriod(const ActivePeriod&) = default;
+            ActivePeriod& operator=(const ActivePeriod&) = default;
+            ~ActivePeriod() = default;
+
+        public:
+            // Replaces the set with the normalized form of ranges. Fails, leaving the set
+            // untouched, if a range lies outside of the day.
+            bool Set(const MOTION_DETECTION_Time_t ranges[], const uint32_t count)
+            {
+                for (uint32_t range = 0; range < count; range++) {
+                    if ((ranges[range].m_startTime >= SecondsPerDay) || (ranges[range].m_endTime > SecondsPerDay)) {
+                        return false;
+                    }
+                }
+
+                _intervals.Clear();
+                for (uint32_t range = 0; range < count; range++) {
+                    const MOTION_DETECTION_Time_t& time = ranges[range];
+                    if (time.m_startTime < time.m_endTime) {
+                        Append(time.m_startTime, time.m_endTime);
+                    } else if (time.m_startTime > time.m_endTime) {
+                        Append(time.m_startTime, SecondsPerDay);
+                        if (time.m_endTime > 0) {
+                            Append(0, time.m_endTime);
+                        }
+                    }
+                }
+
+                std::sort(_intervals.begin(), _intervals.end(),
+                    [](const MOTION_DETECTION_Time_t& lhs, const MOTION_DETECTION_Time_t& rhs) { return (lhs.m_startTime < rhs.m_startTime); });
+
+                uint32_t merged = 0;
+                for (uint32_t interval = 1; interval < _intervals.Size(); interval++) {
+                    MOTION_DETECTION_Time_t& last = _intervals[merged];
+                    if (_intervals[interval].m_startTime <= last.m_endTime) {
+                        last.m_endTime = std::max(last.m_endTime, _intervals[interval].m_endTime);
+                    } else {
+                        _intervals[++merged] = _intervals[interval];
+                    }
+                }
+                if (!_intervals.IsEmpty()) {
+                    _intervals.Resize(merged + 1);
+                }
+                return true;
+            }
+            void Clear()
+            {
+                _intervals.Clear();
+            }
+            bool IsEmpty() const
+            {
+                return _intervals.IsEmpty();
+            }
+
+            bool IsActive(const uint32_t secondOfDay) const
+            {
+                const MOTION_DETECTION_Time_t* after = std::upper_bound(_intervals.begin(), _intervals.end(), secondOfDay,
+                    [](const uint32_t time, const MOTION_DETECTION_Time_t& interval) { return (time < interval.m_startTime); });
+
+                return ((after != _intervals.begin()) && (secondOfDay < (after - 1)->m_endTime));
+            }
+
+            // Seconds from secondOfDay until IsActive() next changes, 0 if it never does (an
+            // empty set or the whole day). Midnight only counts as a change when no interval
+            // runs through it.
+            uint32_t NextChange(const uint32_t secondOfDay) const
+            {
+                const uint32_t count = _intervals.Size();
+
+                if ((count == 0) || ((count == 1) && (_intervals[0].m_startTime == 0) && (_intervals[0].m_endTime == SecondsPerDay))) {
+                    return 0;
+                }
+
+                const bool overnight = ((_intervals[0].m_startTime == 0) && (_intervals[count - 1].m_endTime == SecondsPerDay));
+                for (uint32_t interval = 0; interval < count; interval++) {
+                    const MOTION_DETECTION_Time_t& time = _intervals[interval];
+                    if (time.m_startTime > secondOfDay) {
+                        return (time.m_startTime - secondOfDay);
+                    }
+                    if ((time.m_endTime > secondOfDay) && !(overnight && (time.m_endTime == SecondsPerDay))) {
+                        return (time.m_endTime - secondOfDay);
+                    }
+                }
+
+                const uint32_t tomorrow = SecondsPerDay - secondOfDay;
+                return (tomorrow + (overnight ? _intervals[0].m_endTime : _intervals[0].m_startTime));
+            }
+
+            // Normalized intervals, sorted and disjoint.
+            const Ranges& Intervals() const
+            {
+                return _intervals;
+            }
+
+            // The set in the form handed to the HAL: a period running through midnight is
+            // joined back into a single range with start > end.
+            void Export(Ranges& ranges) const
+            {
+                const uint32_t count = _intervals.Size();
+
+                ranges.Clear();
+                if ((count >= 2) && (_intervals[0].m_startTime == 0) && (_intervals[count - 1].m_endTime == SecondsPerDay)) {
+                    for (uint32_t interval = 1; interval < (count - 1); interval++) {
+                        ranges.PushBack(_intervals[interval]);
+                    }
+                    MOTION_DETECTION_Time_t overnight;
+                    overnight.m_startTime = _intervals[count - 1].m_startTime;
+                    overnight.m_endTime = _intervals[0].m_endTime;
+                    ranges.PushBack(overnight);
+                } else {
+                    ranges = _intervals;
+                }
+            }
+
+        private:
+            void Append(const uint32_t start, const uint32_t end)
+            {
+                MOTION_DETECTION_Time_t interval;
+                interval.m_startTime = start;
+                interval.m_endTime = end;
+                _intervals.PushBack(interval);
+            }
+
+        private:
+            Ranges _intervals;
+        };
+
+    } // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,153 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2026 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace WPEFramework {
+
+    namespace Plugin {
+
+        // Lock-free log-linear latency histogram in microseconds.
+        // Every power of two is split into 8 linear sub-buckets, so a reported percentile is
+        // within 12.5% of the real value for the whole 0 us .. 71 minutes range. Record() is
+        // a handful of relaxed atomic operations and may be called from any thread. Reset()
+        // racing with Record() may lose those samples, which is fine for diagnostics.
+        class LatencyHistogram {
+        public:
+            struct Summary {
+                uint64_t count;
+                uint64_t mean;
+                uint64_t p50;
+                uint64_t p90;
+                uint64_t p99;
+                uint64_t max;
+            };
+
+        private:
+            static constexpr uint32_t SubBucketBits = 3;
+            static constexpr uint32_t SubBuckets = (1 << SubBucketBits);
+            static constexpr uint32_t MaxExponent = 32;
+            static constexpr uint32_t Buckets = SubBuckets + ((MaxExponent - SubBucketBits) * SubBuckets);
+
+            LatencyHistogram(const LatencyHistogram&) = delete;
+            LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+        public:
+            LatencyHistogram()
+            {
+                Reset();
+            }
+            ~LatencyHistogram() = default;
+
+        public:
+            void Record(uint64_t microseconds)
+            {
+                _buckets[Bucket(microseconds)].fetch_add(1, std::memory_order_relaxed);
+                _count.fetch_add(1, std::memory_order_relaxed);
+                _sum.fetch_add(microseconds, std::memory_order_relaxed);
+
+                uint64_t max = _max.load(std::memory_order_relaxed);
+                while ((microseconds > max) && !_max.compare_exchange_weak(max, microseconds, std::memory_order_relaxed)) {
+                }
+            }
+
+            void Reset()
+            {
+                for (uint32_t bucket = 0; bucket < Buckets; bucket++) {
+                    _buckets[bucket].store(0, std::memory_order_relaxed);
+                }
+                _count.store(0, std::memory_order_relaxed);
+                _sum.store(0, std::memory_order_relaxed);
+                _max.store(0, std::memory_order_relaxed);
+            }
+
+            void Summarize(Summary& summary) const
+            {
+                uint64_t counts[Buckets];
+                uint64_t total = 0;
+                for (uint32_t bucket = 0; bucket < Buckets; bucket++) {
+                    counts[bucket] = _buckets[bucket].load(std::memory_order_relaxed);
+                    total += counts[bucket];
+                }
+
+                summary.count = total;
+                summary.max = _max.load(std::memory_order_relaxed);
+                summary.mean = (total != 0) ? (_sum.load(std::memory_order_relaxed) / total) : 0;
+                summary.p50 = Percentile(counts, total, 50, summary.max);
+                summary.p90 = Percentile(counts, total, 90, summary.max);
+                summary.p99 = Percentile(counts, total, 99, summary.max);
+            }
+
+        private:
+            static uint32_t Bucket(uint64_t value)
+            {
+                if (value < SubBuckets) {
+                    return static_cast<uint32_t>(value);
+                }
+                uint32_t exponent = 63 - static_cast<uint32_t>(__builtin_clzll(value));
+                if (exponent >= MaxExponent) {
+                    return Buckets - 1;
+                }
+                uint32_t subBucket = static_cast<uint32_t>(value >> (exponent - SubBucketBits)) & (SubBuckets - 1);
+                return ((exponent - SubBucketBits + 1) * SubBuckets) + subBucket;
+            }
+
+            // Middle of the values that map to a bucket.
+            static uint64_t Value(uint32_t bucket)
+            {
+                if (bucket < SubBuckets) {
+                    return bucket;
+                }
+                uint32_t exponent = (bucket / SubBuckets) + SubBucketBits - 1;
+                uint64_t width = 1ULL << (exponent - SubBucketBits);
+                uint64_t low = (1ULL << exponent) + ((bucket % SubBuckets) * width);
+                return low + (width / 2);
+            }
+
+            static uint64_t Percentile(const uint64_t counts[], uint64_t total, uint32_t percent, uint64_t max)
+            {
+                if (total == 0) {
+                    return 0;
+                }
+                // Rank of the sample, rounded up so p99 of 100 samples is the 99th.
+                uint64_t rank = ((total * percent) + 99) / 100;
+                uint64_t seen = 0;
+                for (uint32_t bucket = 0; bucket < Buckets; bucket++) {
+                    seen += counts[bucket];
+                    if (seen >= rank) {
+                        uint64_t value = Value(bucket);
+                        return (value < max) ? value : max;
+                    }
+                }
+                return max;
+            }
+
+        private:
+            std::atomic<uint64_t> _buckets[Buckets];
+            std::atomic<uint64_t> _count;
+            std::atomic<uint64_t> _sum;
+            std::atomic<uint64_t> _max;
+        };
+
+    } // namespace Plugin
+} // namespace WPEFramework
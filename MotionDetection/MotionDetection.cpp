@@ -25,10 +25,36 @@
 #include <syscall.h>
 #include "UtilsJsonRpc.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <vector>
+
 #include <telemetry_busmessage_sender.h>
 
 #define NO_DETECTORS_FOUND    "0"
 #define MOTION_DETECTOR_INDEX "FP_MD"
+#define COMPACT_RECORD_VERSION 1
+#define MAX_COMPACT_INDEX_LENGTH 255
+#define NO_MOTION_EVENT '0'
+
+#ifdef USE_THUNDER_R4
+#define JSONRPC_CONTEXT Core::JSONRPC::Context
+#else
+#define JSONRPC_CONTEXT Core::JSONRPC::Connection
+#endif
+#define DEFAULT_RECORDING_PATH "/tmp/motiondetection-events.bin"
+
+// Methods that need md-hal wait for the bring-up first, see waitUntilReady().
+#define returnIfHalNotReady() { \
+    if (!waitUntilReady()) { \
+        LOGERR("md-hal is not initialized yet"); \
+        return Core::ERROR_UNAVAILABLE; \
+    } \
+}
 
 #define API_VERSION_NUMBER_MAJOR 1
 #define API_VERSION_NUMBER_MINOR 0
@@ -56,26 +82,60 @@ namespace WPEFramework {
 
         SERVICE_REGISTRATION(MotionDetection, API_VERSION_NUMBER_MAJOR, API_VERSION_NUMBER_MINOR, API_VERSION_NUMBER_PATCH);
 
-        MotionDetection* MotionDetection::_instance = nullptr;
+        std::atomic<MotionDetection*> MotionDetection::_instance(nullptr);
+        std::atomic<uint32_t> MotionDetection::_callbacks(0);
+        std::mutex MotionDetection::_drainLock;
+        std::condition_variable MotionDetection::_drained;
 
         MOTION_DETECTION_Result_t motiondetection_EventCallback (MOTION_DETECTION_EventMessage_t eventMsg)
         {
-            if (!MotionDetection::_instance) {
+            // Announce the callback before looking at the instance, Deinitialize does the
+            // reverse: either it sees this callback in flight, or the callback sees null.
+            MotionDetection::_callbacks.fetch_add(1, std::memory_order_seq_cst);
+            MotionDetection* instance = MotionDetection::_instance.load(std::memory_order_seq_cst);
+            MOTION_DETECTION_Result_t rc = MOTION_DETECTION_RESULT_SUCCESS;
+            if (instance == nullptr) {
                 LOGERR ("Invalid pointer. Motion Detector is not initialized (yet?). Event is ignored");
-                return MOTION_DETECTION_RESULT_INTI_FAILURE;
+                rc = MOTION_DETECTION_RESULT_INTI_FAILURE;
             } else {
-                string index(eventMsg.m_sensorIndex);
-                string eventType(1, eventMsg.m_eventType); 
-                MotionDetection::_instance->onMotionEvent(index, eventType);
-                return MOTION_DETECTION_RESULT_SUCCESS;
+                // Only queue the event here, notifications are sent from the dispatcher thread
+                // so that the md-hal thread is never held up by JSON-RPC or telemetry.
+                instance->enqueueEvent(eventMsg);
+            }
+            // The last callback out wakes a Deinitialize waiting for the callbacks in flight.
+            if ((MotionDetection::_callbacks.fetch_sub(1, std::memory_order_seq_cst) == 1)
+                && (MotionDetection::_instance.load(std::memory_order_seq_cst) == nullptr)) {
+                std::lock_guard<std::mutex> lock(MotionDetection::_drainLock);
+                MotionDetection::_drained.notify_all();
             }
+            return rc;
         }
 
         MotionDetection::MotionDetection()
             : PluginHost::JSONRPC()
+            , m_halReady(false)
+            , m_asyncInit(false)
+            , m_readyTimeout(DEFAULT_READY_TIMEOUT)
+            , m_lastEventTime(0)
+            , m_startTime(0)
+            , m_dispatcherIdle(false)
+            , m_dispatcherRunning(false)
+            , m_reportedDrops(0)
+            , m_detectorCount(0)
+            , m_defaultCoalescingWindow(0)
+            , m_occupancyWheel(OCCUPANCY_WHEEL_RESOLUTION)
+            , m_occupancyTimeout(DEFAULT_OCCUPANCY_TIMEOUT)
+            , m_capabilitiesStale(true)
+            , m_activePeriodValid(false)
+            , m_telemetryMotionEvents(0)
+            , m_telemetryInterval(DEFAULT_TELEMETRY_INTERVAL)
+            , m_recording(false)
+            , m_recordingPath(DEFAULT_RECORDING_PATH)
+            , m_reconcileInterval(DEFAULT_RECONCILE_INTERVAL)
+            , m_armStateDrift(0)
+            , m_scheduleGeneration(0)
         {
             LOGINFO("MotionDetection ctor");
-            MotionDetection::_instance = this;
 
             Register("getMotionDetectors", &MotionDetection::getMotionDetectors, this);
             Register("arm", &MotionDetection::arm, this);
@@ -88,6 +148,24 @@ namespace WPEFramework {
             Register("getLastMotionEventElapsedTime", &MotionDetection::getLastMotionEventElapsedTime, this);
             Register("setMotionEventsActivePeriod", &MotionDetection::setMotionEventsActivePeriod, this);
             Register("getMotionEventsActivePeriod", &MotionDetection::getMotionEventsActivePeriod, this);
+            Register("getMotionEventHistory", &MotionDetection::getMotionEventHistory, this);
+            Register("setEventCoalescing", &MotionDetection::setEventCoalescing, this);
+            Register("refresh", &MotionDetection::refresh, this);
+            Register("configureDetectors", &MotionDetection::configureDetectors, this);
+            Register("isMotionEventsActive", &MotionDetection::isMotionEventsActive, this);
+            Register("getPresence", &MotionDetection::getPresence, this);
+            // Filters belong to the connection that set them, these need the caller's channel.
+            Register("setEventFilter", [this](const JSONRPC_CONTEXT& context, const string& /* method */, const string& parameters, string& result) -> uint32_t {
+                return invokeFromChannel(&MotionDetection::setEventFilter, context.ChannelId(), parameters, result);
+            });
+            Register("setEventEncoding", [this](const JSONRPC_CONTEXT& context, const string& /* method */, const string& parameters, string& result) -> uint32_t {
+                return invokeFromChannel(&MotionDetection::setEventEncoding, context.ChannelId(), parameters, result);
+            });
+            Register("getPerformanceMetrics", &MotionDetection::getPerformanceMetrics, this);
+            Register("resetPerformanceMetrics", &MotionDetection::resetPerformanceMetrics, this);
+            Register("setEventRecording", &MotionDetection::setEventRecording, this);
+            Register("setArmSchedule", &MotionDetection::setArmSchedule, this);
+            Register("getArmSchedule", &MotionDetection::getArmSchedule, this);
 
         }
 
@@ -106,24 +184,193 @@ namespace WPEFramework {
             response.ToString(json);
         }
 
-        const string MotionDetection::Initialize(PluginHost::IShell* /* service */)
+        static uint64_t steadyClockNanoseconds()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        // Milliseconds from the API as nanoseconds, saturated instead of wrapping around.
+        static uint64_t millisecondsToNanoseconds(const uint64_t milliseconds)
+        {
+            return (milliseconds < (UINT64_MAX / 1000000ULL)) ? (milliseconds * 1000000ULL) : UINT64_MAX;
+        }
+
+        static uint64_t wallClockMilliseconds()
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        // Arm schedules follow the local time of the device.
+        static uint32_t localSecondOfDay(const uint64_t wallClockSeconds)
+        {
+            const time_t now = static_cast<time_t>(wallClockSeconds);
+            struct tm local;
+            if (localtime_r(&now, &local) == nullptr) {
+                return static_cast<uint32_t>(wallClockSeconds % ActivePeriod::SecondsPerDay);
+            }
+            return static_cast<uint32_t>((local.tm_hour * 3600) + (local.tm_min * 60) + local.tm_sec);
+        }
+
+        const string MotionDetection::Initialize(PluginHost::IShell* service)
         {
+            if (service != nullptr) {
+                Config config;
+                config.FromString(service->ConfigLine());
+                if (config.EventCoalescingWindow.IsSet()) {
+                    m_defaultCoalescingWindow = std::min(config.EventCoalescingWindow.Value(), static_cast<uint32_t>(MAX_COALESCING_WINDOW));
+                }
+                LOGINFO("Default event coalescing window %u ms", m_defaultCoalescingWindow);
+                if (config.OccupancyTimeout.IsSet() && (config.OccupancyTimeout.Value() > 0)) {
+                    m_occupancyTimeout = config.OccupancyTimeout.Value();
+                }
+                if (config.TelemetryInterval.IsSet()) {
+                    m_telemetryInterval = config.TelemetryInterval.Value();
+                }
+                if (config.AsyncInit.IsSet()) {
+                    m_asyncInit = config.AsyncInit.Value();
+                }
+                if (config.ReadyTimeout.IsSet()) {
+                    m_readyTimeout = config.ReadyTimeout.Value();
+                }
+                if (config.RecordingPath.IsSet() && !config.RecordingPath.Value().empty()) {
+                    m_recordingPath = config.RecordingPath.Value();
+                }
+                if (config.ReconcileInterval.IsSet()) {
+                    m_reconcileInterval = config.ReconcileInterval.Value();
+                }
+                if (config.SchedulePath.IsSet()) {
+                    m_schedulePath = config.SchedulePath.Value();
+                }
+            }
+
+            m_startTime.store(steadyClockNanoseconds(), std::memory_order_relaxed);
+            m_lastEventTime.store(0, std::memory_order_relaxed);
+            startDispatcher();
+
+            if (m_telemetryInterval != 0) {
+                m_telemetryTimer.connect(std::bind(&MotionDetection::flushTelemetry, this));
+                m_telemetryTimer.start(static_cast<int>(m_telemetryInterval * 1000));
+            }
+            if (m_reconcileInterval != 0) {
+                m_reconcileTimer.connect(std::bind(&MotionDetection::reconcileArmStates, this));
+                m_reconcileTimer.start(static_cast<int>(m_reconcileInterval * 1000));
+            }
+            m_scheduleTimer.setSingleShot(true);
+            m_scheduleTimer.connect(std::bind(&MotionDetection::runArmSchedules, this));
+            MotionDetection::_instance.store(this, std::memory_order_seq_cst);
+
+            if (m_asyncInit) {
+                // Do not hold up plugin activation on md-hal, methods wait for onReady.
+                m_initThread = std::thread(&MotionDetection::initializeHal, this);
+            } else {
+                initializeHal();
+            }
+
             // On success return empty, to indicate there is no error text.
+            return (string());
+        }
+
+        void MotionDetection::initializeHal()
+        {
 	    MOTION_DETECTION_Platform_Init();
 
             MOTION_DETECTION_RegisterEventCallback(motiondetection_EventCallback);
 
-            MOTION_DETECTION_DisarmMotionDetector(MOTION_DETECTOR_INDEX);
+            applyDisarm(MOTION_DETECTOR_INDEX);
 
-            m_lastEventTime = std::chrono::system_clock::now();
-            return (string());
+            if (!loadCapabilities()) {
+                LOGWARN("Motion detector capabilities not available yet, will retry on request");
+            }
+
+            loadArmSchedules();
+
+            {
+                std::lock_guard<std::mutex> lock(m_readyMutex);
+                m_halReady.store(true, std::memory_order_release);
+            }
+            m_readyCondition.notify_all();
+            onReady();
+        }
+
+        bool MotionDetection::waitUntilReady()
+        {
+            if (m_halReady.load(std::memory_order_acquire)) {
+                return true;
+            }
+            std::unique_lock<std::mutex> lock(m_readyMutex);
+            return m_readyCondition.wait_for(lock, std::chrono::milliseconds(m_readyTimeout), [this]() {
+                return m_halReady.load(std::memory_order_acquire);
+            });
         }
 
         void MotionDetection::Deinitialize(PluginHost::IShell* /* service */)
         {
             LOGINFO("MotionDetection Deinitialize");
+            if (m_initThread.joinable()) {
+                m_initThread.join();
+            }
+            // Stopping a timer does not wait for a callback that is already running, the
+            // callbacks using md-hal are waited for below instead.
+            m_reconcileTimer.stop();
+            {
+                // The schedules stay in m_schedulePath for the next activation. A run still
+                // going holds the lock, a run after this finds nothing to do and cannot start
+                // the timer again.
+                std::lock_guard<std::mutex> lock(m_scheduleMutex);
+                m_armSchedules.clear();
+                while (!m_armTransitions.empty()) {
+                    m_armTransitions.pop();
+                }
+            }
+            m_scheduleTimer.stop();
+            m_halReady.store(false, std::memory_order_release);
+            {
+                // Waits for a reconcile pass still calling md-hal, later ones see !m_halReady.
+                std::lock_guard<std::mutex> lock(m_reconcileMutex);
+            }
+            // No event may reach the queue once teardown started: callbacks arriving from now
+            // on are ignored, the ones already in enqueueEvent are waited for.
+            MotionDetection::_instance.store(nullptr, std::memory_order_seq_cst);
+            {
+                auto drained = []() { return (MotionDetection::_callbacks.load(std::memory_order_seq_cst) == 0); };
+                std::unique_lock<std::mutex> lock(MotionDetection::_drainLock);
+                if (!MotionDetection::_drained.wait_for(lock, std::chrono::seconds(1), drained)) {
+                    // The instance may not go away under a callback, keep waiting.
+                    LOGWARN("md-hal callbacks still in flight after 1 s, waiting for them");
+                    MotionDetection::_drained.wait(lock, drained);
+                }
+            }
 	    MOTION_DETECTION_Platform_Term();
-            MotionDetection::_instance = nullptr;
+            stopDispatcher();
+            // Nothing is counted once the dispatcher is gone, report what is left.
+            m_telemetryTimer.stop();
+            flushTelemetry();
+            {
+                std::lock_guard<std::mutex> lock(m_recordingMutex);
+                m_recording.store(false, std::memory_order_relaxed);
+                m_recordingLog.Close();
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_capabilitiesMutex);
+                m_capabilities.reset();
+                m_capabilitiesStale = true;
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_activePeriodMutex);
+                m_activePeriodValid = false;
+                m_activePeriod.Clear();
+            }
+            for (uint32_t slot = 0; slot < m_detectorCount.load(std::memory_order_acquire); slot++) {
+                std::lock_guard<std::mutex> lock(m_detectors[slot].settingsLock);
+                m_detectors[slot].settings.noMotionPeriodValid = false;
+                m_detectors[slot].settings.sensitivityValid = false;
+                m_detectors[slot].settings.armStateValid = false;
+                m_detectors[slot].settings.armModeValid = false;
+            }
+            LOGINFO("Event queue: dropped %u, high-water mark %u of %u",
+                m_eventQueue.Dropped(), m_eventQueue.HighWaterMark(), m_eventQueue.Capacity());
             Unregister("getMotionDetectors");
             Unregister("arm");
             Unregister("disarm");
@@ -135,46 +382,34 @@ namespace WPEFramework {
             Unregister("getLastMotionEventElapsedTime");
             Unregister("setMotionEventsActivePeriod");
             Unregister("getMotionEventsActivePeriod");
+            Unregister("getMotionEventHistory");
+            Unregister("setEventCoalescing");
+            Unregister("refresh");
+            Unregister("configureDetectors");
+            Unregister("isMotionEventsActive");
+            Unregister("getPresence");
+            Unregister("setEventFilter");
+            Unregister("setEventEncoding");
+            Unregister("getPerformanceMetrics");
+            Unregister("resetPerformanceMetrics");
+            Unregister("setEventRecording");
+            Unregister("setArmSchedule");
+            Unregister("getArmSchedule");
         }
 
         //Begin methods
         uint32_t MotionDetection::getMotionDetectors(const JsonObject& parameters, JsonObject& response)
         {
             LOGINFOMETHOD();
-            MOTION_DETECTION_Result_t rc = MOTION_DETECTION_RESULT_SUCCESS;
-            MOTION_DETECTION_CurrentSensorSettings_t motionDetectors;
-            JsonObject sensorData;
-            JsonArray dectectorList;
-            JsonObject detectorInfo;
-
-            rc = MOTION_DETECTION_GetMotionDetectors(&motionDetectors);
+            returnIfHalNotReady();
+            std::shared_ptr<const CapabilityTable> table = capabilities();
 
-            if (rc != MOTION_DETECTION_RESULT_SUCCESS) {
+            if (!table) {
                 LOGERR("Failed to fetch list of motion detectors..!");
                 response["supportedMotionDetectors"] = NO_DETECTORS_FOUND;
                 returnResponse(false);
             }
-            sensorData["description"] = string(motionDetectors.m_sensorDescription);
-	    sensorData["type"] = string(motionDetectors.m_sensorType);
-	    sensorData["distance"] = std::to_string(motionDetectors.m_sensorDistance);
-            sensorData["angle"] = std::to_string(motionDetectors.m_sensorAngle);
-            sensorData["sensitivityMode"] = std::to_string(motionDetectors.m_sensitivityMode);
-            if (motionDetectors.m_sensitivityMode == SENSITIVITY_MODE_LEVELS) {
-                std::vector<std::string> sensitivityIdentifiers;
-                for (int identifiers = 0; identifiers < SENSITIVITY_IDENTIFIERS; identifiers++) {
-                    sensitivityIdentifiers.push_back(string(motionDetectors.m_sensitivity[identifiers]));
-                }
-                setResponseArray(sensorData, "sensitivities", sensitivityIdentifiers);
-            }
-            else if (motionDetectors.m_sensitivityMode == SENSITIVITY_MODE_INT) {
-                sensorData["min"] = string(motionDetectors.m_sensitivity[SENSITIVITY_IDENTIFIER_1]);
-                sensorData["max"] = string(motionDetectors.m_sensitivity[SENSITIVITY_IDENTIFIER_1]);
-                sensorData["step"] = string(motionDetectors.m_sensitivity[SENSITIVITY_IDENTIFIER_1]);
-            }
-            detectorInfo[motionDetectors.m_sensorIndex] = sensorData;
-            dectectorList.Add(std::string(motionDetectors.m_sensorIndex));
-            response["supportedMotionDetectors"] = dectectorList;
-            response["supportedMotionDetectorsInfo"] =  detectorInfo;
+            response = table->response;
 
             returnResponse(true);
         }
@@ -182,6 +417,7 @@ namespace WPEFramework {
         uint32_t MotionDetection::arm(const JsonObject& parameters, JsonObject& response)
         {
             LOGINFOMETHOD();
+            returnIfHalNotReady();
             string index = parameters["index"].String();
             string sMode = parameters["mode"].String();
             int mode;
@@ -192,7 +428,7 @@ namespace WPEFramework {
                 returnResponse(false);
             }
             MOTION_DETECTION_Result_t rc = MOTION_DETECTION_RESULT_SUCCESS;
-            rc = MOTION_DETECTION_ArmMotionDetector((MOTION_DETECTION_Mode_t)mode, index.c_str());
+            rc = applyArm(index, mode);
 
             if (rc != MOTION_DETECTION_RESULT_SUCCESS) {
                 LOGERR("Failed to arm the motion detector..!");
@@ -205,9 +441,10 @@ namespace WPEFramework {
         uint32_t MotionDetection::disarm(const JsonObject& parameters, JsonObject& response)
         {
             LOGINFOMETHOD();
+            returnIfHalNotReady();
             string index = parameters["index"].String();
             MOTION_DETECTION_Result_t rc = MOTION_DETECTION_RESULT_SUCCESS;
-            rc = MOTION_DETECTION_DisarmMotionDetector(index.c_str());
+            rc = applyDisarm(index);
 
             if (rc != MOTION_DETECTION_RESULT_SUCCESS) {
                 LOGERR("Failed to disarm the motion detector..!");
@@ -220,10 +457,11 @@ namespace WPEFramework {
         uint32_t MotionDetection::isarmed(const JsonObject& parameters, JsonObject& response)
         {
             LOGINFOMETHOD();
+            returnIfHalNotReady();
             string index = parameters["index"].String();
             bool armState = false;
             MOTION_DETECTION_Result_t rc = MOTION_DETECTION_RESULT_SUCCESS;
-            rc = MOTION_DETECTION_IsMotionDetectorArmed(index.c_str(), &armState);
+            rc = readArmState(index, armState, true);
 
             if (rc != MOTION_DETECTION_RESULT_SUCCESS) {
                 LOGERR("Failed to check motion detector status..!");
@@ -240,6 +478,7 @@ namespace WPEFramework {
         uint32_t MotionDetection::setNoMotionPeriod(const JsonObject& parameters, JsonObject& response)
         {
             LOGINFOMETHOD();
+            returnIfHalNotReady();
             string index = parameters["index"].String();
             string sPeriod = parameters["period"].String();
             int period;
@@ -250,7 +489,7 @@ namespace WPEFramework {
                 returnResponse(false);
             }
             MOTION_DETECTION_Result_t rc = MOTION_DETECTION_RESULT_SUCCESS;
-            rc = MOTION_DETECTION_SetNoMotionPeriod(index.c_str(), period);
+            rc = applyNoMotionPeriod(index, period);
 
             if (rc != MOTION_DETECTION_RESULT_SUCCESS) {
                 LOGERR("Failed to set no motion period..!");
@@ -262,10 +501,11 @@ namespace WPEFramework {
         uint32_t MotionDetection::getNoMotionPeriod(const JsonObject& parameters, JsonObject& response)
         {
             LOGINFOMETHOD();
+            returnIfHalNotReady();
             string index = parameters["index"].String();
             MOTION_DETECTION_Result_t rc = MOTION_DETECTION_RESULT_SUCCESS;
             unsigned int period = 0;
-            rc = MOTION_DETECTION_GetNoMotionPeriod(index.c_str(), &period);
+            rc = readNoMotionPeriod(index, period, true);
 
             if (rc != MOTION_DETECTION_RESULT_SUCCESS) {
                 LOGERR("Failed to get no motion period..!");
@@ -278,6 +518,7 @@ namespace WPEFramework {
         uint32_t MotionDetection::setSensitivity(const JsonObject& parameters, JsonObject& response)
         {
             LOGINFOMETHOD();
+            returnIfHalNotReady();
             string index = parameters["index"].String();
             string sensitivity;
             int    inferredMode = 0;
@@ -297,7 +538,7 @@ namespace WPEFramework {
             }
 
             MOTION_DETECTION_Result_t rc = MOTION_DETECTION_RESULT_SUCCESS;
-            rc = MOTION_DETECTION_SetSensitivity(index.c_str(), sensitivity.c_str(), inferredMode);
+            rc = applySensitivity(index, sensitivity, inferredMode);
 
             if (rc != MOTION_DETECTION_RESULT_SUCCESS) {
                 LOGERR("Failed to set sensitivity..!");
@@ -310,27 +551,25 @@ namespace WPEFramework {
         uint32_t MotionDetection::getSensitivity(const JsonObject& parameters, JsonObject& response)
         {
             LOGINFOMETHOD();
+            returnIfHalNotReady();
             string index = parameters["index"].String();
-            char *sensitivity = nullptr;
+            string sensitivity;
             int currentMode = 0; 
             MOTION_DETECTION_Result_t rc = MOTION_DETECTION_RESULT_SUCCESS;
-            rc = MOTION_DETECTION_GetSensitivity(index.c_str(), &sensitivity, &currentMode);
+            rc = readSensitivity(index, sensitivity, currentMode, true);
 
             if (rc != MOTION_DETECTION_RESULT_SUCCESS) {
                 LOGERR("Failed to get sensitivity..!");
                 returnResponse(false);
             }
 
-            if (sensitivity) {
-                string rSensitivity(sensitivity);
-
+            if (!sensitivity.empty()) {
                 if (currentMode == 1) {
-                    response["value"] = rSensitivity;
+                    response["value"] = sensitivity;
                 }
                 else if (currentMode == 2) {
-                    response["name"] = rSensitivity;
+                    response["name"] = sensitivity;
                 }
-                free(sensitivity);
             }
             returnResponse(true);
 
@@ -340,76 +579,60 @@ namespace WPEFramework {
         {
             LOGINFOMETHOD();
             string index = parameters["index"].String();
-            MOTION_DETECTION_Result_t rc = MOTION_DETECTION_RESULT_SUCCESS;
-            double eventElapsedTime = 0;
-            std::chrono::duration<double> elapsedTime = std::chrono::system_clock::now() - m_lastEventTime;
+            uint64_t lastEvent = 0;
+
+            // Wait-free: an existing slot is found without locking and the stamps are atomics.
+            // A detector without a slot has not sent any event yet.
+            if (!index.empty()) {
+                int slot = detectorSlot(index.c_str(), false);
+                if (slot >= 0) {
+                    lastEvent = m_detectors[slot].lastEventTime.load(std::memory_order_relaxed);
+                }
+            } else {
+                lastEvent = m_lastEventTime.load(std::memory_order_relaxed);
+            }
+            // Without any event yet, the time since the plugin started.
+            if (lastEvent == 0) {
+                lastEvent = m_startTime.load(std::memory_order_relaxed);
+            }
 
-            eventElapsedTime = elapsedTime.count();
+            uint64_t now = steadyClockNanoseconds();
+            uint64_t elapsed = (now > lastEvent) ? (now - lastEvent) : 0;
+            response["time"] = static_cast<double>(elapsed) / 1000000000.0;
 
-            if (rc != MOTION_DETECTION_RESULT_SUCCESS) {
-                LOGERR("Failed to get last motion event elapsed time..!");
-                returnResponse(false);
+            bool wallClock = false;
+            getBoolParameter("wallClock", wallClock);
+            if (wallClock) {
+                // Wall clock time of the event, derived from the monotonic age so NTP steps
+                // do not affect the elapsed time itself.
+                uint64_t wallNow = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count();
+                response["wallClockTime"] = wallNow - (elapsed / 1000000ULL);
             }
-            response["time"] = std::to_string(eventElapsedTime);
             returnResponse(true);
         }
 
         uint32_t MotionDetection::setMotionEventsActivePeriod(const JsonObject& parameters, JsonObject& response)
         {
              LOGINFOMETHOD();
+            returnIfHalNotReady();
              if (parameters.HasLabel("index") && parameters.HasLabel("nowTime") && parameters.HasLabel("ranges"))
              {
                  MOTION_DETECTION_Result_t rc = MOTION_DETECTION_RESULT_SUCCESS;
-                 MOTION_DETECTION_TimeRange_t timeSet;
-                 int nowTime = 0;
-                 bool parseStatus = true;
+                 unsigned int nowTime = 0;
+                 ActivePeriod activePeriod;
                  string index = parameters["index"].String();
-                 JsonArray rangeList = parameters["ranges"].Array();
-                 getNumberParameterObject(parameters, "nowTime", nowTime);
-                 timeSet.m_nowTime = nowTime;
-                 timeSet.m_timeRangeArray = (MOTION_DETECTION_Time_t *)malloc(rangeList.Length() * sizeof(MOTION_DETECTION_Time_t));
-                 timeSet.m_rangeCount = rangeList.Length();
-                 
-                 // Check malloc success
-                 if (timeSet.m_timeRangeArray == nullptr) {
-                     LOGERR("Failed to allocate memory for time range array");
-                     returnResponse(false);
-                 }
-                 
-                 for (int range = 0;  range < rangeList.Length(); range++)
-                 {
-                     JsonObject rangeObj = rangeList[range].Object();
-                     if (rangeObj.HasLabel("startTime") && rangeObj.HasLabel("endTime"))
-                     {
-                         unsigned int startTime = 0, endTime = 0;
-                         getNumberParameterObject(rangeObj, "startTime", startTime);
-                         getNumberParameterObject(rangeObj, "endTime", endTime);
-                         timeSet.m_timeRangeArray[range].m_startTime = startTime;
-                         timeSet.m_timeRangeArray[range].m_endTime = endTime;
-                     }
-                     else
-                     {
-                         LOGINFO("Parameters missing in JSON Array");
-                         parseStatus = false;
-                         break;
-                     }
-                 }
-                 if (parseStatus == true)
+
+                 if (!parseActivePeriod(parameters, nowTime, activePeriod))
                  {
-                     rc = MOTION_DETECTION_SetActivePeriod(index.c_str(), timeSet);
-                     if (rc != MOTION_DETECTION_RESULT_SUCCESS) 
-                     {
-                         LOGERR("Failed to set Active Time..!");
-                         free(timeSet.m_timeRangeArray);
-                         returnResponse(false);
-                     }
+                     returnResponse(false);
                  }
-                 else
+                 rc = applyActivePeriod(index, nowTime, activePeriod);
+                 if (rc != MOTION_DETECTION_RESULT_SUCCESS)
                  {
-                     free(timeSet.m_timeRangeArray);
+                     LOGERR("Failed to set Active Time..!");
                      returnResponse(false);
                  }
-                 free(timeSet.m_timeRangeArray);
                  returnResponse(true);
              }
              else
@@ -423,46 +646,1783 @@ namespace WPEFramework {
         uint32_t MotionDetection::getMotionEventsActivePeriod(const JsonObject& parameters, JsonObject& response)
         {
              LOGINFOMETHOD();
+            returnIfHalNotReady();
              MOTION_DETECTION_Result_t rc = MOTION_DETECTION_RESULT_SUCCESS;
-             MOTION_DETECTION_TimeRange_t timeSet;
+             ActivePeriod activePeriod;
+             ActivePeriod::Ranges ranges;
              JsonArray rangeList;
-             rc = MOTION_DETECTION_GetActivePeriod(&timeSet);
+             rc = readActivePeriod(activePeriod, true);
              if (rc != MOTION_DETECTION_RESULT_SUCCESS) {
                  LOGERR("Failed to get Active Time..!");
                  returnResponse(false);
              }
-             if (timeSet.m_rangeCount > 0)
+             activePeriod.Export(ranges);
+             if (!ranges.IsEmpty())
              {
-                 for (int range = 0; range < timeSet.m_rangeCount; range++)
+                 for (auto& range : ranges)
                  {
                      JsonObject rangeObj;
-                     rangeObj["startTime"] = std::to_string(timeSet.m_timeRangeArray[range].m_startTime);
-                     rangeObj["endTime"] = std::to_string(timeSet.m_timeRangeArray[range].m_endTime);
+                     rangeObj["startTime"] = std::to_string(range.m_startTime);
+                     rangeObj["endTime"] = std::to_string(range.m_endTime);
                      rangeList.Add(rangeObj);
                  }
                  response["ranges"] = rangeList;
              }
-             else if (timeSet.m_rangeCount == 0)
+             else
              {
                  response["message"] = "No Active Periods Set";
              }
              returnResponse(true);
         }
-        //End methods
 
-        //Begin events
-        void MotionDetection::onMotionEvent(const string& index, const string& eventType)
+        uint32_t MotionDetection::isMotionEventsActive(const JsonObject& parameters, JsonObject& response)
         {
-            JsonObject params;
-            params["index"] = index;
-            params["mode"] = eventType;
-            sendNotify("onMotionEvent", params);
+            LOGINFOMETHOD();
+            returnIfHalNotReady();
+            returnIfParamNotFound(parameters, "time");
+
+            int time = -1;
+            getNumberParameterObject(parameters, "time", time);
+            if ((time < 0) || (static_cast<uint32_t>(time) >= ActivePeriod::SecondsPerDay)) {
+                LOGERR("time must be in seconds since midnight");
+                returnResponse(false);
+            }
+
+            // Answered from the cached, normalized active period; only the first call after
+            // start-up or a refresh goes to the HAL.
+            ActivePeriod activePeriod;
+            if (readActivePeriod(activePeriod, true) != MOTION_DETECTION_RESULT_SUCCESS) {
+                LOGERR("Failed to get Active Time..!");
+                returnResponse(false);
+            }
+            // Without an active period motion events are not restricted.
+            response["active"] = (activePeriod.IsEmpty() || activePeriod.IsActive(time));
+            returnResponse(true);
+        }
+
+        const char* MotionDetection::presenceName(int state)
+        {
+            switch (state) {
+            case OCCUPANCY_PRESENT:
+                return "present";
+            case OCCUPANCY_ABSENT:
+                return "absent";
+            default:
+                return "uncertain";
+            }
+        }
 
-			t2_event_d("SYST_INFO_NotifyMotion", 1);
+        uint32_t MotionDetection::getPresence(const JsonObject& parameters, JsonObject& response)
+        {
+            LOGINFOMETHOD();
+            returnIfParamNotFound(parameters, "index");
+
+            string index = parameters["index"].String();
+            int slot = detectorSlot(index.c_str(), false);
+            if (slot < 0) {
+                LOGERR("Unknown motion detector '%s'", index.c_str());
+                returnResponse(false);
+            }
 
-            m_lastEventTime = std::chrono::system_clock::now();
+            const DetectorState& detector = m_detectors[slot];
+            response["index"] = index;
+            response["state"] = string(presenceName(detector.presence.load(std::memory_order_relaxed)));
+            response["since"] = detector.presenceSince.load(std::memory_order_relaxed) / 1000000ULL;
+            returnResponse(true);
+        }
+
+        uint32_t MotionDetection::getMotionEventHistory(const JsonObject& parameters, JsonObject& response)
+        {
+            LOGINFOMETHOD();
+            returnIfParamNotFound(parameters, "index");
+
+            string index = parameters["index"].String();
+            uint64_t now = steadyClockNanoseconds() / 1000000ULL;
+            uint64_t since = 0;
+            uint64_t until = now;
+            uint32_t limit = EVENT_HISTORY_CAPACITY;
+
+            if (parameters.HasLabel("since")) {
+                since = static_cast<uint64_t>(parameters["since"].Number());
+            }
+            if (parameters.HasLabel("until")) {
+                until = static_cast<uint64_t>(parameters["until"].Number());
+            }
+            if (parameters.HasLabel("limit")) {
+                uint32_t requested = static_cast<uint32_t>(parameters["limit"].Number());
+                limit = (requested < limit) ? requested : limit;
+            }
+            if (since > until) {
+                LOGERR("Invalid time range since %llu until %llu", (unsigned long long)since, (unsigned long long)until);
+                returnResponse(false);
+            }
+
+            std::vector<MotionEventHistory<EVENT_HISTORY_CAPACITY>::Entry> entries;
+            int slot = detectorSlot(index.c_str(), false);
+            if (slot >= 0) {
+                entries.reserve(limit);
+                // The ring stores nanoseconds, the API uses milliseconds (until includes its whole millisecond).
+                const uint64_t last = millisecondsToNanoseconds(until);
+                m_detectors[slot].history.Query(millisecondsToNanoseconds(since), (last <= (UINT64_MAX - 999999ULL)) ? (last + 999999ULL) : UINT64_MAX, limit, entries);
+            }
+
+            JsonArray events;
+            for (auto& entry : entries) {
+                JsonObject event;
+                event["time"] = static_cast<uint64_t>(entry.timestamp / 1000000ULL);
+                event["mode"] = string(1, static_cast<char>(entry.eventType));
+                events.Add(event);
+            }
+            response["index"] = index;
+            response["now"] = now;
+            response["events"] = events;
+            returnResponse(true);
+        }
+
+        uint32_t MotionDetection::setEventCoalescing(const JsonObject& parameters, JsonObject& response)
+        {
+            LOGINFOMETHOD();
+            returnIfParamNotFound(parameters, "index");
+            returnIfParamNotFound(parameters, "window");
+
+            string index = parameters["index"].String();
+            int window = -1;
+            getNumberParameter("window", window);
+            if ((window < 0) || (window > static_cast<int>(MAX_COALESCING_WINDOW))) {
+                LOGERR("Invalid coalescing window %d, expected 0..%u ms", window, MAX_COALESCING_WINDOW);
+                returnResponse(false);
+            }
+
+            // Slots only exist for detectors the HAL reported or accepted, an index we have
+            // not seen yet is probed first so a typo does not use up a slot.
+            int slot = detectorSlot(index.c_str(), false);
+            if (slot < 0) {
+                unsigned int period = 0;
+                if (waitUntilReady() && (readNoMotionPeriod(index, period, true) == MOTION_DETECTION_RESULT_SUCCESS)) {
+                    slot = detectorSlot(index.c_str(), false);
+                }
+            }
+            if (slot < 0) {
+                LOGERR("Unknown motion detector '%s'", index.c_str());
+                returnResponse(false);
+            }
+            m_detectors[slot].coalescingWindow.store(static_cast<uint32_t>(window), std::memory_order_relaxed);
+            returnResponse(true);
+        }
+
+        uint32_t MotionDetection::refresh(const JsonObject& parameters, JsonObject& response)
+        {
+            LOGINFOMETHOD();
+            returnIfHalNotReady();
+            std::vector<string> indexes;
+
+            if (parameters.HasLabel("index")) {
+                indexes.push_back(parameters["index"].String());
+            } else {
+                uint32_t count = m_detectorCount.load(std::memory_order_acquire);
+                for (uint32_t slot = 0; slot < count; slot++) {
+                    indexes.push_back(m_detectors[slot].index);
+                }
+            }
+
+            // Re-read everything from the HAL; reading with cached == false also replaces
+            // whatever the cache held before.
+            bool success = true;
+            for (auto& index : indexes) {
+                unsigned int period = 0;
+                string sensitivity;
+                int mode = 0;
+                if (readNoMotionPeriod(index, period, false) != MOTION_DETECTION_RESULT_SUCCESS) {
+                    LOGERR("Failed to refresh no motion period of '%s'", index.c_str());
+                    success = false;
+                }
+                if (readSensitivity(index, sensitivity, mode, false) != MOTION_DETECTION_RESULT_SUCCESS) {
+                    LOGERR("Failed to refresh sensitivity of '%s'", index.c_str());
+                    success = false;
+                }
+                bool armed = false;
+                if (readArmState(index, armed, false) != MOTION_DETECTION_RESULT_SUCCESS) {
+                    LOGERR("Failed to refresh arm state of '%s'", index.c_str());
+                    success = false;
+                }
+            }
+            ActivePeriod activePeriod;
+            if (readActivePeriod(activePeriod, false) != MOTION_DETECTION_RESULT_SUCCESS) {
+                LOGERR("Failed to refresh active period");
+                success = false;
+            }
+            returnResponse(success);
+        }
+
+        uint32_t MotionDetection::configureDetectors(const JsonObject& parameters, JsonObject& response)
+        {
+            LOGINFOMETHOD();
+            returnIfHalNotReady();
+            returnIfParamNotFound(parameters, "detectors");
+
+            JsonArray detectorList = parameters["detectors"].Array();
+            std::vector<DetectorConfiguration> configurations(detectorList.Length());
+            JsonArray results;
+
+            // Validate the whole batch before anything is sent to the HAL.
+            bool valid = (detectorList.Length() > 0);
+            for (int item = 0; item < detectorList.Length(); item++) {
+                JsonObject result;
+                string error = parseDetectorConfiguration(detectorList[item].Object(), configurations[item]);
+                result["index"] = configurations[item].index;
+                result["success"] = error.empty();
+                if (!error.empty()) {
+                    result["error"] = error;
+                    valid = false;
+                }
+                results.Add(result);
+            }
+            if (!valid) {
+                LOGERR("Invalid detector configuration, nothing applied");
+                response["results"] = results;
+                returnResponse(false);
+            }
+
+            // undoStart[item] is the first undo entry of that item.
+            std::vector<ConfigurationUndo> undoLog;
+            std::vector<size_t> undoStart(configurations.size() + 1, 0);
+            string error;
+            size_t failed = configurations.size();
+            for (size_t item = 0; item < configurations.size(); item++) {
+                undoStart[item] = undoLog.size();
+                if (!applyDetectorConfiguration(configurations[item], undoLog, error)) {
+                    failed = item;
+                    break;
+                }
+                undoStart[item + 1] = undoLog.size();
+            }
+
+            bool rollbackComplete = true;
+            if (failed != configurations.size()) {
+                LOGERR("Failed to configure '%s': %s, rolling back", configurations[failed].index.c_str(), error.c_str());
+                rollbackComplete = rollbackConfiguration(undoLog);
+            }
+
+            results.Clear();
+            for (size_t item = 0; item < configurations.size(); item++) {
+                JsonObject result;
+                result["index"] = configurations[item].index;
+                if (failed == configurations.size()) {
+                    result["success"] = true;
+                    result["status"] = "applied";
+                } else {
+                    result["success"] = false;
+                    if (item < failed) {
+                        bool restored = true;
+                        for (size_t entry = undoStart[item]; entry < undoStart[item + 1]; entry++) {
+                            restored = restored && undoLog[entry].restored;
+                        }
+                        result["status"] = restored ? "rolledBack" : "rollbackFailed";
+                    } else if (item == failed) {
+                        result["status"] = "failed";
+                        result["error"] = error;
+                    } else {
+                        result["status"] = "skipped";
+                    }
+                }
+                results.Add(result);
+            }
+            response["results"] = results;
+            if (failed != configurations.size()) {
+                response["rollbackComplete"] = rollbackComplete;
+            }
+            returnResponse(failed == configurations.size());
+        }
+
+        uint32_t MotionDetection::invokeFromChannel(uint32_t (MotionDetection::*method)(const uint32_t, const JsonObject&, JsonObject&),
+            const uint32_t channel, const string& parameters, string& result)
+        {
+            JsonObject request;
+            JsonObject response;
+            if (!parameters.empty() && !request.FromString(parameters)) {
+                return Core::ERROR_BAD_REQUEST;
+            }
+            uint32_t status = (this->*method)(channel, request, response);
+            // Like the registered handlers, an error carries no result.
+            if (status == Core::ERROR_NONE) {
+                response.ToString(result);
+            }
+            return status;
+        }
+
+        uint32_t MotionDetection::setEventFilter(const uint32_t channel, const JsonObject& parameters, JsonObject& response)
+        {
+            LOGINFOMETHOD();
+            returnIfParamNotFound(parameters, "id");
+
+            // The id is the designator the client passed to register for onMotionEvent.
+            string id = parameters["id"].String();
+            if (id.empty()) {
+                LOGERR("Invalid client id");
+                returnResponse(false);
+            }
+
+            EventFilter filter;
+            if (parameters.HasLabel("indexes")) {
+                JsonArray indexList = parameters["indexes"].Array();
+                for (int item = 0; item < indexList.Length(); item++) {
+                    string index = indexList[item].String();
+                    if (index.empty() || (index.length() > MAX_INDEX_LENGTH)) {
+                        LOGERR("Invalid motion detector index '%s'", index.c_str());
+                        returnResponse(false);
+                    }
+                    filter.indexes.insert(index);
+                }
+            }
+            if (parameters.HasLabel("eventTypes")) {
+                JsonArray typeList = parameters["eventTypes"].Array();
+                for (int item = 0; item < typeList.Length(); item++) {
+                    string eventType = typeList[item].String();
+                    if (eventType.length() != 1) {
+                        LOGERR("Invalid event type '%s', expected a single character", eventType.c_str());
+                        returnResponse(false);
+                    }
+                    filter.eventTypes.set(static_cast<unsigned char>(eventType[0]));
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_eventFiltersMutex);
+                auto entry = m_eventFilters.find(id);
+                if ((entry != m_eventFilters.end()) && (entry->second.channel != channel)) {
+                    LOGERR("Event filter of client '%s' belongs to another connection", id.c_str());
+                    returnResponse(false);
+                }
+                filter.compact = ((entry != m_eventFilters.end()) && entry->second.compact);
+                filter.channel = channel;
+                // A filter without restrictions is the same as no filter at all.
+                if (filter.indexes.empty() && filter.eventTypes.none() && !filter.compact) {
+                    m_eventFilters.erase(id);
+                } else {
+                    m_eventFilters[id] = filter;
+                }
+                publishEventFilters();
+            }
+            returnResponse(true);
+        }
+
+        uint32_t MotionDetection::setEventEncoding(const uint32_t channel, const JsonObject& parameters, JsonObject& response)
+        {
+            LOGINFOMETHOD();
+            returnIfParamNotFound(parameters, "id");
+            returnIfParamNotFound(parameters, "encoding");
+
+            string id = parameters["id"].String();
+            string encoding = parameters["encoding"].String();
+            if (id.empty() || ((encoding != "json") && (encoding != "compact"))) {
+                LOGERR("Invalid encoding '%s' for client '%s', expected json or compact", encoding.c_str(), id.c_str());
+                returnResponse(false);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_eventFiltersMutex);
+                auto entry = m_eventFilters.find(id);
+                if ((entry != m_eventFilters.end()) && (entry->second.channel != channel)) {
+                    LOGERR("Event encoding of client '%s' belongs to another connection", id.c_str());
+                    returnResponse(false);
+                }
+                if (encoding == "compact") {
+                    if (entry == m_eventFilters.end()) {
+                        EventFilter filter;
+                        filter.compact = true;
+                        filter.channel = channel;
+                        m_eventFilters[id] = filter;
+                    } else {
+                        entry->second.compact = true;
+                    }
+                } else if (entry != m_eventFilters.end()) {
+                    entry->second.compact = false;
+                    if (entry->second.indexes.empty() && entry->second.eventTypes.none()) {
+                        m_eventFilters.erase(entry);
+                    }
+                }
+                publishEventFilters();
+            }
+            returnResponse(true);
+        }
+
+        static JsonObject latencySummary(const LatencyHistogram& histogram)
+        {
+            LatencyHistogram::Summary summary;
+            histogram.Summarize(summary);
+
+            JsonObject result;
+            result["count"] = summary.count;
+            result["mean"] = summary.mean;
+            result["p50"] = summary.p50;
+            result["p90"] = summary.p90;
+            result["p99"] = summary.p99;
+            result["max"] = summary.max;
+            return result;
+        }
+
+        uint32_t MotionDetection::getPerformanceMetrics(const JsonObject& parameters, JsonObject& response)
+        {
+            LOGINFOMETHOD();
+
+            // All latencies are in microseconds.
+            JsonObject hal;
+            for (int call = 0; call < HAL_CALL_COUNT; call++) {
+                hal[halCallName(call)] = latencySummary(m_halLatency[call]);
+            }
+            response["hal"] = hal;
+            response["eventLatency"] = latencySummary(m_eventLatency);
+
+            JsonObject queue;
+            queue["dropped"] = m_eventQueue.Dropped();
+            queue["highWaterMark"] = m_eventQueue.HighWaterMark();
+            queue["capacity"] = m_eventQueue.Capacity();
+            response["queue"] = queue;
+            response["armStateDrift"] = m_armStateDrift.load(std::memory_order_relaxed);
+            returnResponse(true);
+        }
+
+        uint32_t MotionDetection::resetPerformanceMetrics(const JsonObject& parameters, JsonObject& response)
+        {
+            LOGINFOMETHOD();
+            for (int call = 0; call < HAL_CALL_COUNT; call++) {
+                m_halLatency[call].Reset();
+            }
+            m_eventLatency.Reset();
+            m_armStateDrift.store(0, std::memory_order_relaxed);
+            returnResponse(true);
+        }
+
+        uint32_t MotionDetection::setEventRecording(const JsonObject& parameters, JsonObject& response)
+        {
+            LOGINFOMETHOD();
+            returnIfBooleanParamNotFound(parameters, "enable");
+
+            bool enable = parameters["enable"].Boolean();
+            std::lock_guard<std::mutex> lock(m_recordingMutex);
+            if (enable) {
+                // Enabling again starts a new recording.
+                m_recording.store(false, std::memory_order_relaxed);
+                if (!m_recordingLog.Open(m_recordingPath)) {
+                    LOGERR("Failed to open event recording '%s'", m_recordingPath.c_str());
+                    returnResponse(false);
+                }
+                LOGINFO("Recording motion events to '%s'", m_recordingPath.c_str());
+                m_recording.store(true, std::memory_order_relaxed);
+            } else {
+                m_recording.store(false, std::memory_order_relaxed);
+                m_recordingLog.Close();
+            }
+            response["path"] = m_recordingPath;
+            response["events"] = m_recordingLog.Records();
+            returnResponse(true);
+        }
+
+        uint32_t MotionDetection::setArmSchedule(const JsonObject& parameters, JsonObject& response)
+        {
+            LOGINFOMETHOD();
+            returnIfHalNotReady();
+            returnIfParamNotFound(parameters, "index");
+            returnIfParamNotFound(parameters, "ranges");
+
+            string index = parameters["index"].String();
+            unsigned int nowTime = 0;
+            ArmSchedule schedule;
+            schedule.mode = 0;
+            schedule.generation = 0;
+            if (index.empty() || !parseActivePeriod(parameters, nowTime, schedule.period)) {
+                returnResponse(false);
+            }
+            // No ranges clears the schedule, the detector keeps its current state.
+            if (!schedule.period.IsEmpty()) {
+                try {
+                    schedule.mode = stoi(parameters["mode"].String());
+                } catch (const std::exception& err) {
+                    LOGERR("Failed to get Mode value..!");
+                    returnResponse(false);
+                }
+            }
+
+            // Applied under the lock, so a transition of the schedule being replaced cannot be
+            // applied in between. The previous schedule keeps its generation and its queued
+            // transition, restoring it undoes the change.
+            std::lock_guard<std::mutex> lock(m_scheduleMutex);
+            const uint64_t now = wallClockMilliseconds() / 1000;
+            std::map<string, ArmSchedule>::const_iterator entry = m_armSchedules.find(index);
+            const bool replaced = (entry != m_armSchedules.end());
+            const ArmSchedule previous = replaced ? entry->second : schedule;
+
+            if (schedule.period.IsEmpty()) {
+                m_armSchedules.erase(index);
+            } else {
+                schedule.generation = ++m_scheduleGeneration;
+                m_armSchedules[index] = schedule;
+            }
+            if (!saveArmSchedules()) {
+                LOGERR("Arm schedule of '%s' not changed, it could not be saved", index.c_str());
+                restoreArmSchedule(index, replaced, previous);
+                returnResponse(false);
+            }
+
+            if (!schedule.period.IsEmpty()) {
+                // The queue only holds changes, bring the detector into the scheduled state now.
+                if (applyArmSchedule(index, schedule.period.IsActive(localSecondOfDay(now)), schedule.mode) != MOTION_DETECTION_RESULT_SUCCESS) {
+                    LOGERR("Failed to apply the arm schedule..!");
+                    restoreArmSchedule(index, replaced, previous);
+                    saveArmSchedules();
+                    returnResponse(false);
+                }
+                queueArmTransition(index, schedule, now);
+            }
+            startArmScheduleTimer();
+            returnResponse(true);
+        }
+
+        uint32_t MotionDetection::getArmSchedule(const JsonObject& parameters, JsonObject& response)
+        {
+            LOGINFOMETHOD();
+            returnIfParamNotFound(parameters, "index");
+
+            string index = parameters["index"].String();
+            ArmSchedule schedule;
+            bool found = false;
+            {
+                std::lock_guard<std::mutex> lock(m_scheduleMutex);
+                std::map<string, ArmSchedule>::const_iterator entry = m_armSchedules.find(index);
+                if (entry != m_armSchedules.end()) {
+                    schedule = entry->second;
+                    found = true;
+                }
+            }
+            if (!found) {
+                response["message"] = "No Arm Schedule Set";
+                returnResponse(true);
+            }
+
+            ActivePeriod::Ranges ranges;
+            JsonArray rangeList;
+            schedule.period.Export(ranges);
+            for (auto& range : ranges) {
+                JsonObject rangeObj;
+                rangeObj["startTime"] = std::to_string(range.m_startTime);
+                rangeObj["endTime"] = std::to_string(range.m_endTime);
+                rangeList.Add(rangeObj);
+            }
+            response["ranges"] = rangeList;
+            response["mode"] = std::to_string(schedule.mode);
+            returnResponse(true);
+        }
+        //End methods
+
+        bool MotionDetection::parseActivePeriod(const JsonObject& parameters, unsigned int& nowTime, ActivePeriod& activePeriod)
+        {
+            int now = 0;
+            ActivePeriod::Ranges ranges;
+            JsonArray rangeList = parameters["ranges"].Array();
+            getNumberParameterObject(parameters, "nowTime", now);
+            nowTime = now;
+
+            for (int range = 0; range < rangeList.Length(); range++)
+            {
+                JsonObject rangeObj = rangeList[range].Object();
+                if (rangeObj.HasLabel("startTime") && rangeObj.HasLabel("endTime"))
+                {
+                    MOTION_DETECTION_Time_t time;
+                    unsigned int startTime = 0, endTime = 0;
+                    getNumberParameterObject(rangeObj, "startTime", startTime);
+                    getNumberParameterObject(rangeObj, "endTime", endTime);
+                    time.m_startTime = startTime;
+                    time.m_endTime = endTime;
+                    ranges.PushBack(time);
+                }
+                else
+                {
+                    LOGINFO("Parameters missing in JSON Array");
+                    return false;
+                }
+            }
+            if (!activePeriod.Set(ranges.Data(), ranges.Size()))
+            {
+                LOGERR("Active period range outside of the day");
+                return false;
+            }
+            return true;
+        }
+
+        string MotionDetection::parseDetectorConfiguration(const JsonObject& parameters, DetectorConfiguration& configuration)
+        {
+            configuration.index = parameters["index"].String();
+            configuration.arm = false;
+            configuration.mode = 0;
+            configuration.disarm = false;
+            configuration.hasPeriod = false;
+            configuration.period = 0;
+            configuration.hasSensitivity = false;
+            configuration.sensitivityMode = 0;
+            configuration.hasActivePeriod = false;
+            configuration.nowTime = 0;
+
+            if (!parameters.HasLabel("index") || configuration.index.empty()) {
+                return "index missing";
+            }
+            if (parameters.HasLabel("mode")) {
+                try {
+                    configuration.mode = stoi(parameters["mode"].String());
+                } catch (const std::exception& err) {
+                    return "invalid mode";
+                }
+                configuration.arm = true;
+            }
+            if (parameters.HasLabel("armed")) {
+                bool armed = true;
+                getBoolParameter("armed", armed);
+                if (!armed && configuration.arm) {
+                    return "mode given for a detector to be disarmed";
+                }
+                configuration.disarm = !armed;
+            }
+            if (parameters.HasLabel("period")) {
+                try {
+                    configuration.period = stoi(parameters["period"].String());
+                } catch (const std::exception& err) {
+                    return "invalid period";
+                }
+                configuration.hasPeriod = true;
+            }
+            if (parameters.HasLabel("name")) {
+                configuration.sensitivity = parameters["name"].String();
+                configuration.sensitivityMode = 2;
+                configuration.hasSensitivity = true;
+            }
+            if (parameters.HasLabel("value")) {
+                configuration.sensitivity = parameters["value"].String();
+                configuration.sensitivityMode = 1;
+                configuration.hasSensitivity = true;
+            }
+            if (parameters.HasLabel("ranges")) {
+                if (!parameters.HasLabel("nowTime") || !parseActivePeriod(parameters, configuration.nowTime, configuration.activePeriod)) {
+                    return "invalid active period";
+                }
+                configuration.hasActivePeriod = true;
+            }
+            return string();
+        }
+
+        bool MotionDetection::applyDetectorConfiguration(const DetectorConfiguration& configuration, std::vector<ConfigurationUndo>& undoLog, string& error)
+        {
+            const string& index = configuration.index;
+            ConfigurationUndo undo;
+            undo.index = index;
+            undo.restored = false;
+
+            // Settings first, arming last so a detector never runs with half of its new
+            // configuration. A previous value that cannot be read cannot be rolled back, the
+            // change is still logged so a rollback knows it is incomplete.
+            if (configuration.hasSensitivity) {
+                undo.setting = ConfigurationUndo::SENSITIVITY;
+                undo.restorable = (readSensitivity(index, undo.sensitivity, undo.sensitivityMode, true) == MOTION_DETECTION_RESULT_SUCCESS);
+                if (applySensitivity(index, configuration.sensitivity, configuration.sensitivityMode) != MOTION_DETECTION_RESULT_SUCCESS) {
+                    error = "Failed to set sensitivity";
+                    return false;
+                }
+                undoLog.push_back(undo);
+            }
+            if (configuration.hasPeriod) {
+                undo.setting = ConfigurationUndo::NO_MOTION_PERIOD;
+                undo.restorable = (readNoMotionPeriod(index, undo.period, true) == MOTION_DETECTION_RESULT_SUCCESS);
+                if (applyNoMotionPeriod(index, configuration.period) != MOTION_DETECTION_RESULT_SUCCESS) {
+                    error = "Failed to set no motion period";
+                    return false;
+                }
+                undoLog.push_back(undo);
+            }
+            if (configuration.hasActivePeriod) {
+                undo.setting = ConfigurationUndo::ACTIVE_PERIOD;
+                undo.nowTime = configuration.nowTime;
+                undo.restorable = (readActivePeriod(undo.activePeriod, true) == MOTION_DETECTION_RESULT_SUCCESS);
+                if (applyActivePeriod(index, configuration.nowTime, configuration.activePeriod) != MOTION_DETECTION_RESULT_SUCCESS) {
+                    error = "Failed to set active period";
+                    return false;
+                }
+                undoLog.push_back(undo);
+            }
+            if (configuration.arm || configuration.disarm) {
+                undo.setting = ConfigurationUndo::ARM_STATE;
+                undo.armed = false;
+                undo.modeValid = false;
+                undo.mode = 0;
+                undo.restorable = (readArmState(index, undo.armed, true) == MOTION_DETECTION_RESULT_SUCCESS);
+                int slot = detectorSlot(index.c_str(), false);
+                if (slot >= 0) {
+                    std::lock_guard<std::mutex> lock(m_detectors[slot].settingsLock);
+                    undo.modeValid = m_detectors[slot].settings.armModeValid;
+                    undo.mode = m_detectors[slot].settings.armMode;
+                }
+
+                MOTION_DETECTION_Result_t rc = configuration.arm ? applyArm(index, configuration.mode) : applyDisarm(index);
+                if (rc != MOTION_DETECTION_RESULT_SUCCESS) {
+                    error = configuration.arm ? "Failed to arm the motion detector" : "Failed to disarm the motion detector";
+                    return false;
+                }
+                undoLog.push_back(undo);
+            }
+            return true;
+        }
+
+        bool MotionDetection::rollbackConfiguration(std::vector<ConfigurationUndo>& undoLog)
+        {
+            bool complete = true;
+
+            for (auto undo = undoLog.rbegin(); undo != undoLog.rend(); ++undo) {
+                undo->restored = false;
+                if (!undo->restorable) {
+                    LOGWARN("Previous setting %d of '%s' is unknown, it cannot be restored", undo->setting, undo->index.c_str());
+                    complete = false;
+                    continue;
+                }
+                MOTION_DETECTION_Result_t rc = MOTION_DETECTION_RESULT_SUCCESS;
+                switch (undo->setting) {
+                case ConfigurationUndo::SENSITIVITY:
+                    rc = applySensitivity(undo->index, undo->sensitivity, undo->sensitivityMode);
+                    break;
+                case ConfigurationUndo::NO_MOTION_PERIOD:
+                    rc = applyNoMotionPeriod(undo->index, undo->period);
+                    break;
+                case ConfigurationUndo::ACTIVE_PERIOD:
+                    rc = applyActivePeriod(undo->index, undo->nowTime, undo->activePeriod);
+                    break;
+                case ConfigurationUndo::ARM_STATE:
+                    if (!undo->armed) {
+                        rc = applyDisarm(undo->index);
+                    } else if (undo->modeValid) {
+                        rc = applyArm(undo->index, undo->mode);
+                    } else {
+                        LOGWARN("Previous arm mode of '%s' is unknown, it cannot be restored", undo->index.c_str());
+                        complete = false;
+                        continue;
+                    }
+                    break;
+                }
+                if (rc != MOTION_DETECTION_RESULT_SUCCESS) {
+                    LOGERR("Failed to roll back setting %d of '%s'", undo->setting, undo->index.c_str());
+                    complete = false;
+                    continue;
+                }
+                undo->restored = true;
+            }
+            return complete;
+        }
+
+        MOTION_DETECTION_Result_t MotionDetection::applyArm(const string& index, int mode)
+        {
+            uint64_t start = steadyClockNanoseconds();
+            MOTION_DETECTION_Result_t rc = MOTION_DETECTION_ArmMotionDetector((MOTION_DETECTION_Mode_t)mode, index.c_str());
+            recordHalLatency(HAL_ARM, start);
+            int slot;
+            if ((rc == MOTION_DETECTION_RESULT_SUCCESS) && ((slot = detectorSlot(index.c_str(), true)) >= 0)) {
+                std::lock_guard<std::mutex> lock(m_detectors[slot].settingsLock);
+                m_detectors[slot].settings.armed = true;
+                m_detectors[slot].settings.armStateValid = true;
+                m_detectors[slot].settings.armMode = mode;
+                m_detectors[slot].settings.armModeValid = true;
+            }
+            return rc;
+        }
+
+        MOTION_DETECTION_Result_t MotionDetection::applyDisarm(const string& index)
+        {
+            uint64_t start = steadyClockNanoseconds();
+            MOTION_DETECTION_Result_t rc = MOTION_DETECTION_DisarmMotionDetector(index.c_str());
+            recordHalLatency(HAL_DISARM, start);
+            int slot;
+            if ((rc == MOTION_DETECTION_RESULT_SUCCESS) && ((slot = detectorSlot(index.c_str(), true)) >= 0)) {
+                std::lock_guard<std::mutex> lock(m_detectors[slot].settingsLock);
+                m_detectors[slot].settings.armed = false;
+                m_detectors[slot].settings.armStateValid = true;
+            }
+            return rc;
+        }
+
+        MOTION_DETECTION_Result_t MotionDetection::applyNoMotionPeriod(const string& index, unsigned int period)
+        {
+            uint64_t start = steadyClockNanoseconds();
+            MOTION_DETECTION_Result_t rc = MOTION_DETECTION_SetNoMotionPeriod(index.c_str(), period);
+            recordHalLatency(HAL_SET_NO_MOTION_PERIOD, start);
+            int slot;
+            if ((rc == MOTION_DETECTION_RESULT_SUCCESS) && ((slot = detectorSlot(index.c_str(), true)) >= 0)) {
+                std::lock_guard<std::mutex> lock(m_detectors[slot].settingsLock);
+                m_detectors[slot].settings.noMotionPeriod = period;
+                m_detectors[slot].settings.noMotionPeriodValid = true;
+            }
+            return rc;
+        }
+
+        MOTION_DETECTION_Result_t MotionDetection::applySensitivity(const string& index, const string& sensitivity, int mode)
+        {
+            uint64_t start = steadyClockNanoseconds();
+            MOTION_DETECTION_Result_t rc = MOTION_DETECTION_SetSensitivity(index.c_str(), sensitivity.c_str(), mode);
+            recordHalLatency(HAL_SET_SENSITIVITY, start);
+            int slot;
+            if ((rc == MOTION_DETECTION_RESULT_SUCCESS) && ((slot = detectorSlot(index.c_str(), true)) >= 0)) {
+                std::lock_guard<std::mutex> lock(m_detectors[slot].settingsLock);
+                m_detectors[slot].settings.sensitivity = sensitivity;
+                m_detectors[slot].settings.sensitivityMode = mode;
+                m_detectors[slot].settings.sensitivityValid = true;
+            }
+            return rc;
+        }
+
+        MOTION_DETECTION_Result_t MotionDetection::applyActivePeriod(const string& index, unsigned int nowTime, const ActivePeriod& activePeriod)
+        {
+            ActivePeriod::Ranges ranges;
+            activePeriod.Export(ranges);
+
+            MOTION_DETECTION_TimeRange_t timeSet;
+            timeSet.m_nowTime = nowTime;
+            timeSet.m_rangeCount = ranges.Size();
+            timeSet.m_timeRangeArray = ranges.Data();
+
+            uint64_t start = steadyClockNanoseconds();
+            MOTION_DETECTION_Result_t rc = MOTION_DETECTION_SetActivePeriod(index.c_str(), timeSet);
+            recordHalLatency(HAL_SET_ACTIVE_PERIOD, start);
+            if (rc == MOTION_DETECTION_RESULT_SUCCESS) {
+                std::lock_guard<std::mutex> lock(m_activePeriodMutex);
+                m_activePeriod = activePeriod;
+                m_activePeriodValid = true;
+            }
+            return rc;
+        }
+
+        MOTION_DETECTION_Result_t MotionDetection::readArmState(const string& index, bool& armed, bool cached)
+        {
+            int slot = detectorSlot(index.c_str(), false);
+            if (slot >= 0) {
+                DetectorState& detector = m_detectors[slot];
+                std::lock_guard<std::mutex> lock(detector.settingsLock);
+                if (cached && detector.settings.armStateValid) {
+                    armed = detector.settings.armed;
+                    return MOTION_DETECTION_RESULT_SUCCESS;
+                }
+                detector.settings.armStateValid = false;
+            }
+
+            uint64_t start = steadyClockNanoseconds();
+            MOTION_DETECTION_Result_t rc = MOTION_DETECTION_IsMotionDetectorArmed(index.c_str(), &armed);
+            recordHalLatency(HAL_IS_ARMED, start);
+            if ((rc == MOTION_DETECTION_RESULT_SUCCESS) && ((slot = detectorSlot(index.c_str(), true)) >= 0)) {
+                DetectorState& detector = m_detectors[slot];
+                std::lock_guard<std::mutex> lock(detector.settingsLock);
+                detector.settings.armed = armed;
+                detector.settings.armStateValid = true;
+            }
+            return rc;
+        }
+
+        // Runs on the reconcile timer thread. The whole pass holds m_reconcileMutex, so
+        // Deinitialize cannot terminate md-hal under it.
+        void MotionDetection::reconcileArmStates()
+        {
+            std::lock_guard<std::mutex> passLock(m_reconcileMutex);
+            if (!m_halReady.load(std::memory_order_acquire)) {
+                return;
+            }
+
+            uint32_t count = m_detectorCount.load(std::memory_order_acquire);
+            for (uint32_t slot = 0; slot < count; slot++) {
+                DetectorState& detector = m_detectors[slot];
+                bool cached = false;
+                {
+                    std::lock_guard<std::mutex> lock(detector.settingsLock);
+                    if (!detector.settings.armStateValid) {
+                        continue;
+                    }
+                    cached = detector.settings.armed;
+                }
+
+                bool armed = false;
+                uint64_t start = steadyClockNanoseconds();
+                MOTION_DETECTION_Result_t rc = MOTION_DETECTION_IsMotionDetectorArmed(detector.index, &armed);
+                recordHalLatency(HAL_IS_ARMED, start);
+                if ((rc != MOTION_DETECTION_RESULT_SUCCESS) || (armed == cached)) {
+                    continue;
+                }
+
+                std::lock_guard<std::mutex> lock(detector.settingsLock);
+                // An arm or disarm that raced with the HAL read is not drift.
+                if (detector.settings.armStateValid && (detector.settings.armed == cached)) {
+                    LOGWARN("Arm state of '%s' drifted: cached %s, md-hal %s", detector.index,
+                        cached ? "armed" : "disarmed", armed ? "armed" : "disarmed");
+                    m_armStateDrift.fetch_add(1, std::memory_order_relaxed);
+                    detector.settings.armed = armed;
+                }
+            }
+        }
+
+        // Arms or disarms the detector unless the cache says it already is in that state.
+        MOTION_DETECTION_Result_t MotionDetection::applyArmSchedule(const string& index, bool active, int mode)
+        {
+            int slot = detectorSlot(index.c_str(), false);
+            if (slot >= 0) {
+                std::lock_guard<std::mutex> lock(m_detectors[slot].settingsLock);
+                const SettingsCache& settings = m_detectors[slot].settings;
+                if (settings.armStateValid && (settings.armed == active)
+                    && (!active || (settings.armModeValid && (settings.armMode == mode)))) {
+                    return MOTION_DETECTION_RESULT_SUCCESS;
+                }
+            }
+            return (active ? applyArm(index, mode) : applyDisarm(index));
+        }
+
+        // Called with m_scheduleMutex held.
+        void MotionDetection::queueArmTransition(const string& index, const ArmSchedule& schedule, uint64_t now)
+        {
+            uint32_t next = schedule.period.NextChange(localSecondOfDay(now));
+            if (next != 0) {
+                ArmTransition transition;
+                transition.due = now + next;
+                transition.index = index;
+                transition.generation = schedule.generation;
+                m_armTransitions.push(transition);
+            }
+        }
+
+        // Called with m_scheduleMutex held.
+        void MotionDetection::restoreArmSchedule(const string& index, bool replaced, const ArmSchedule& previous)
+        {
+            if (replaced) {
+                m_armSchedules[index] = previous;
+            } else {
+                m_armSchedules.erase(index);
+            }
+        }
+
+        // Called with m_scheduleMutex held. The timer is single shot, every run of
+        // runArmSchedules starts it again for the next transition.
+        void MotionDetection::startArmScheduleTimer()
+        {
+            if (m_armTransitions.empty()) {
+                m_scheduleTimer.stop();
+                return;
+            }
+            uint64_t now = wallClockMilliseconds();
+            uint64_t due = m_armTransitions.top().due * 1000;
+            m_scheduleTimer.start(static_cast<int>((due > now) ? (due - now) : 0));
+        }
+
+        // Runs on the schedule timer thread. The state is taken from the schedule at the
+        // time the timer fires, so a late timer or a clock change cannot arm out of period.
+        // Transitions are applied under m_scheduleMutex, like setArmSchedule, so the two
+        // never interleave; once Deinitialize cleared the schedules there is nothing to run.
+        void MotionDetection::runArmSchedules()
+        {
+            std::lock_guard<std::mutex> lock(m_scheduleMutex);
+            uint64_t now = wallClockMilliseconds() / 1000;
+            uint32_t secondOfDay = localSecondOfDay(now);
+            bool halReady = m_halReady.load(std::memory_order_acquire);
+            while (!m_armTransitions.empty() && (m_armTransitions.top().due <= now)) {
+                ArmTransition transition = m_armTransitions.top();
+                m_armTransitions.pop();
+
+                std::map<string, ArmSchedule>::const_iterator schedule = m_armSchedules.find(transition.index);
+                if ((schedule == m_armSchedules.end()) || (schedule->second.generation != transition.generation)) {
+                    continue; // replaced or cleared since
+                }
+                bool active = schedule->second.period.IsActive(secondOfDay);
+                if (halReady && (applyArmSchedule(transition.index, active, schedule->second.mode) != MOTION_DETECTION_RESULT_SUCCESS)) {
+                    LOGERR("Scheduled %s of '%s' failed", active ? "arm" : "disarm", transition.index.c_str());
+                }
+                queueArmTransition(transition.index, schedule->second, now);
+            }
+            startArmScheduleTimer();
+        }
+
+        // Restores the schedules saved by a previous activation, runs during md-hal bring-up.
+        void MotionDetection::loadArmSchedules()
+        {
+            if (m_schedulePath.empty()) {
+                return;
+            }
+            std::ifstream stream(m_schedulePath.c_str());
+            if (!stream) {
+                return; // nothing saved yet
+            }
+            std::stringstream content;
+            content << stream.rdbuf();
+
+            JsonObject file;
+            if (!file.FromString(content.str())) {
+                LOGERR("Ignoring unreadable arm schedules '%s'", m_schedulePath.c_str());
+                return;
+            }
+
+            JsonArray schedules = file["schedules"].Array();
+            uint64_t now = wallClockMilliseconds() / 1000;
+            uint32_t secondOfDay = localSecondOfDay(now);
+
+            std::lock_guard<std::mutex> lock(m_scheduleMutex);
+            for (int position = 0; position < schedules.Length(); position++) {
+                JsonObject scheduleObj = schedules[position].Object();
+                string index = scheduleObj["index"].String();
+                unsigned int nowTime = 0;
+                ArmSchedule schedule;
+                schedule.mode = 0;
+                getNumberParameterObject(scheduleObj, "mode", schedule.mode);
+                if (index.empty() || !parseActivePeriod(scheduleObj, nowTime, schedule.period) || schedule.period.IsEmpty()) {
+                    LOGWARN("Ignoring invalid arm schedule %d in '%s'", position, m_schedulePath.c_str());
+                    continue;
+                }
+                // Kept on failure, the next transition tries again.
+                if (applyArmSchedule(index, schedule.period.IsActive(secondOfDay), schedule.mode) != MOTION_DETECTION_RESULT_SUCCESS) {
+                    LOGERR("Failed to apply the arm schedule of '%s'", index.c_str());
+                }
+                schedule.generation = ++m_scheduleGeneration;
+                m_armSchedules[index] = schedule;
+                queueArmTransition(index, schedule, now);
+            }
+            LOGINFO("Restored %u arm schedules from '%s'", static_cast<uint32_t>(m_armSchedules.size()), m_schedulePath.c_str());
+            startArmScheduleTimer();
+        }
+
+        // Called with m_scheduleMutex held. Written to a temporary file first, so a power
+        // cut never leaves a truncated schedule file behind.
+        bool MotionDetection::saveArmSchedules()
+        {
+            if (m_schedulePath.empty()) {
+                return true;
+            }
+
+            JsonArray schedules;
+            for (const auto& entry : m_armSchedules) {
+                JsonObject scheduleObj;
+                JsonArray rangeList;
+                for (const MOTION_DETECTION_Time_t& range : entry.second.period.Intervals()) {
+                    JsonObject rangeObj;
+                    rangeObj["startTime"] = range.m_startTime;
+                    rangeObj["endTime"] = range.m_endTime;
+                    rangeList.Add(rangeObj);
+                }
+                scheduleObj["index"] = entry.first;
+                scheduleObj["mode"] = entry.second.mode;
+                scheduleObj["ranges"] = rangeList;
+                schedules.Add(scheduleObj);
+            }
+            JsonObject file;
+            file["schedules"] = schedules;
+            string json;
+            file.ToString(json);
+
+            string temporary = m_schedulePath + ".tmp";
+            std::ofstream stream(temporary.c_str(), std::ios::out | std::ios::trunc);
+            stream << json;
+            stream.close();
+            if (!stream || (std::rename(temporary.c_str(), m_schedulePath.c_str()) != 0)) {
+                LOGERR("Failed to save arm schedules to '%s'", m_schedulePath.c_str());
+                std::remove(temporary.c_str());
+                return false;
+            }
+            return true;
+        }
+
+        MOTION_DETECTION_Result_t MotionDetection::readNoMotionPeriod(const string& index, unsigned int& period, bool cached)
+        {
+            int slot = detectorSlot(index.c_str(), false);
+            if (slot >= 0) {
+                DetectorState& detector = m_detectors[slot];
+                std::lock_guard<std::mutex> lock(detector.settingsLock);
+                if (cached && detector.settings.noMotionPeriodValid) {
+                    period = detector.settings.noMotionPeriod;
+                    return MOTION_DETECTION_RESULT_SUCCESS;
+                }
+                detector.settings.noMotionPeriodValid = false;
+            }
+
+            uint64_t start = steadyClockNanoseconds();
+            MOTION_DETECTION_Result_t rc = MOTION_DETECTION_GetNoMotionPeriod(index.c_str(), &period);
+            recordHalLatency(HAL_GET_NO_MOTION_PERIOD, start);
+            // Only indexes the HAL accepts get a slot.
+            if ((rc == MOTION_DETECTION_RESULT_SUCCESS) && ((slot = detectorSlot(index.c_str(), true)) >= 0)) {
+                DetectorState& detector = m_detectors[slot];
+                std::lock_guard<std::mutex> lock(detector.settingsLock);
+                detector.settings.noMotionPeriod = period;
+                detector.settings.noMotionPeriodValid = true;
+            }
+            return rc;
+        }
+
+        MOTION_DETECTION_Result_t MotionDetection::readSensitivity(const string& index, string& sensitivity, int& mode, bool cached)
+        {
+            int slot = detectorSlot(index.c_str(), false);
+            if (slot >= 0) {
+                DetectorState& detector = m_detectors[slot];
+                std::lock_guard<std::mutex> lock(detector.settingsLock);
+                if (cached && detector.settings.sensitivityValid) {
+                    sensitivity = detector.settings.sensitivity;
+                    mode = detector.settings.sensitivityMode;
+                    return MOTION_DETECTION_RESULT_SUCCESS;
+                }
+                detector.settings.sensitivityValid = false;
+            }
+
+            char *value = nullptr;
+            uint64_t start = steadyClockNanoseconds();
+            MOTION_DETECTION_Result_t rc = MOTION_DETECTION_GetSensitivity(index.c_str(), &value, &mode);
+            recordHalLatency(HAL_GET_SENSITIVITY, start);
+            if (rc == MOTION_DETECTION_RESULT_SUCCESS) {
+                sensitivity = (value != nullptr) ? string(value) : string();
+                if ((slot = detectorSlot(index.c_str(), true)) >= 0) {
+                    DetectorState& detector = m_detectors[slot];
+                    std::lock_guard<std::mutex> lock(detector.settingsLock);
+                    detector.settings.sensitivity = sensitivity;
+                    detector.settings.sensitivityMode = mode;
+                    detector.settings.sensitivityValid = true;
+                }
+            }
+            if (value != nullptr) {
+                free(value);
+            }
+            return rc;
+        }
+
+        MOTION_DETECTION_Result_t MotionDetection::readActivePeriod(ActivePeriod& activePeriod, bool cached)
+        {
+            std::lock_guard<std::mutex> lock(m_activePeriodMutex);
+            if (cached && m_activePeriodValid) {
+                activePeriod = m_activePeriod;
+                return MOTION_DETECTION_RESULT_SUCCESS;
+            }
+            m_activePeriodValid = false;
+
+            MOTION_DETECTION_TimeRange_t timeSet;
+            memset(&timeSet, 0, sizeof(timeSet));
+            uint64_t start = steadyClockNanoseconds();
+            MOTION_DETECTION_Result_t rc = MOTION_DETECTION_GetActivePeriod(&timeSet);
+            recordHalLatency(HAL_GET_ACTIVE_PERIOD, start);
+            if (rc == MOTION_DETECTION_RESULT_SUCCESS) {
+                activePeriod.Clear();
+                if ((timeSet.m_rangeCount > 0) && (timeSet.m_timeRangeArray != nullptr)
+                    && !activePeriod.Set(timeSet.m_timeRangeArray, timeSet.m_rangeCount)) {
+                    // Not cached, so the next request asks the HAL again.
+                    LOGERR("HAL reported an active period outside of the day");
+                    return rc;
+                }
+                m_activePeriod = activePeriod;
+                m_activePeriodValid = true;
+            }
+            return rc;
+        }
+
+        //Begin events
+        void MotionDetection::onMotionEvent(const string& index, const string& eventType)
+        {
+            JsonObject params;
+            params["index"] = index;
+            params["mode"] = eventType;
+            notifyMotionEvent(index, eventType, params, 1, 0, 0);
+
+            countMotionTelemetry(1);
+        }
+
+        void MotionDetection::onMotionEvent(const string& index, const string& eventType, uint32_t count, uint64_t firstTime, uint64_t lastTime)
+        {
+            JsonObject params;
+            params["index"] = index;
+            params["mode"] = eventType;
+            params["count"] = count;
+            params["firstTime"] = firstTime;
+            params["lastTime"] = lastTime;
+            notifyMotionEvent(index, eventType, params, count, firstTime, lastTime);
+
+            countMotionTelemetry(count);
+        }
+
+        void MotionDetection::onPresenceChanged(const string& index, int state, int previousState)
+        {
+            JsonObject params;
+            params["index"] = index;
+            params["state"] = string(presenceName(state));
+            params["previousState"] = string(presenceName(previousState));
+            sendNotify("onPresenceChanged", params);
+        }
+
+        void MotionDetection::onReady()
+        {
+            JsonObject params;
+            sendNotify("onReady", params);
+        }
+        //End events
+
+        void MotionDetection::recordHalLatency(HalCall call, uint64_t start)
+        {
+            m_halLatency[call].Record((steadyClockNanoseconds() - start) / 1000ULL);
+        }
+
+        const char* MotionDetection::halCallName(int call)
+        {
+            switch (call) {
+            case HAL_ARM:
+                return "MOTION_DETECTION_ArmMotionDetector";
+            case HAL_DISARM:
+                return "MOTION_DETECTION_DisarmMotionDetector";
+            case HAL_IS_ARMED:
+                return "MOTION_DETECTION_IsMotionDetectorArmed";
+            case HAL_SET_NO_MOTION_PERIOD:
+                return "MOTION_DETECTION_SetNoMotionPeriod";
+            case HAL_GET_NO_MOTION_PERIOD:
+                return "MOTION_DETECTION_GetNoMotionPeriod";
+            case HAL_SET_SENSITIVITY:
+                return "MOTION_DETECTION_SetSensitivity";
+            case HAL_GET_SENSITIVITY:
+                return "MOTION_DETECTION_GetSensitivity";
+            case HAL_SET_ACTIVE_PERIOD:
+                return "MOTION_DETECTION_SetActivePeriod";
+            case HAL_GET_ACTIVE_PERIOD:
+                return "MOTION_DETECTION_GetActivePeriod";
+            default:
+                return "MOTION_DETECTION_GetMotionDetectors";
+            }
+        }
+
+        void MotionDetection::countMotionTelemetry(uint32_t count)
+        {
+            if (m_telemetryInterval == 0) {
+                t2_event_d("SYST_INFO_NotifyMotion", count);
+            } else {
+                m_telemetryMotionEvents.fetch_add(count, std::memory_order_relaxed);
+            }
+        }
+
+        void MotionDetection::flushTelemetry()
+        {
+            uint32_t count = m_telemetryMotionEvents.exchange(0, std::memory_order_relaxed);
+            if (count != 0) {
+                t2_event_d("SYST_INFO_NotifyMotion", count);
+            }
+        }
+
+        // Called with m_eventFiltersMutex held.
+        void MotionDetection::publishEventFilters()
+        {
+            if (m_eventFilters.empty()) {
+                m_eventFilterTable.reset();
+                return;
+            }
+
+            std::shared_ptr<EventFilterTable> table = std::make_shared<EventFilterTable>();
+            for (auto& entry : m_eventFilters) {
+                const EventFilter& filter = entry.second;
+                std::bitset<256> eventTypes = filter.eventTypes;
+                if (eventTypes.none()) {
+                    eventTypes.set();
+                }
+
+                table->filtered.insert(entry.first);
+                if (filter.compact) {
+                    table->compact.insert(entry.first);
+                }
+                if (filter.indexes.empty()) {
+                    table->anyIndex[entry.first] = eventTypes;
+                } else {
+                    for (auto& index : filter.indexes) {
+                        table->byIndex[index][entry.first] = eventTypes;
+                    }
+                }
+            }
+            m_eventFilterTable = table;
+        }
+
+        // Packs an event into the fixed layout documented in the README and base64 encodes it:
+        // version, event type, index length, index, count (LE32), firstTime and lastTime (LE64,
+        // monotonic ms). The index is never cut short, one that does not fit the length byte
+        // cannot be encoded.
+        static bool encodeMotionRecord(const string& index, const string& eventType, uint32_t count, uint64_t firstTime, uint64_t lastTime, string& encoded)
+        {
+            const size_t indexLength = index.length();
+            if (indexLength > MAX_COMPACT_INDEX_LENGTH) {
+                LOGERR("Index '%s' is too long for a compact record", index.c_str());
+                return false;
+            }
+
+            uint8_t record[3 + MAX_COMPACT_INDEX_LENGTH + 4 + 8 + 8];
+            uint32_t length = 0;
+
+            record[length++] = COMPACT_RECORD_VERSION;
+            record[length++] = eventType.empty() ? 0 : static_cast<uint8_t>(eventType[0]);
+            record[length++] = static_cast<uint8_t>(indexLength);
+            memcpy(&record[length], index.data(), indexLength);
+            length += indexLength;
+            for (int byte = 0; byte < 4; byte++) {
+                record[length++] = static_cast<uint8_t>(count >> (8 * byte));
+            }
+            for (int byte = 0; byte < 8; byte++) {
+                record[length++] = static_cast<uint8_t>(firstTime >> (8 * byte));
+            }
+            for (int byte = 0; byte < 8; byte++) {
+                record[length++] = static_cast<uint8_t>(lastTime >> (8 * byte));
+            }
+
+            Core::ToString(record, length, true, encoded);
+            return true;
+        }
+
+        void MotionDetection::notifyClients(const char* event, const JsonObject& params, const std::function<bool(const string&)>& accept)
+        {
+#if ((THUNDER_VERSION >= 4) && (THUNDER_VERSION_MINOR == 4))
+            if (accept) {
+                Notify(event, params, accept);
+            } else {
+                Notify(event, params);
+            }
+#else
+            for (uint8_t i = 1; GetHandler(i); i++) {
+                if (accept) {
+                    GetHandler(i)->Notify(event, params, accept);
+                } else {
+                    GetHandler(i)->Notify(event, params);
+                }
+            }
+#endif
+        }
+
+        void MotionDetection::notifyMotionEvent(const string& index, const string& eventType, const JsonObject& params, uint32_t count, uint64_t firstTime, uint64_t lastTime)
+        {
+            // Per event logging is a trace category: nothing is formatted unless
+            // Trace::Information is enabled for the plugin.
+            TRACE(Trace::Information, (_T("Notify onMotionEvent index %s mode %s count %u firstTime %llu lastTime %llu"),
+                index.c_str(), eventType.c_str(), count,
+                static_cast<unsigned long long>(firstTime), static_cast<unsigned long long>(lastTime)));
+
+            std::shared_ptr<const EventFilterTable> table;
+            {
+                std::lock_guard<std::mutex> lock(m_eventFiltersMutex);
+                table = m_eventFilterTable;
+            }
+            if (!table) {
+                notifyClients("onMotionEvent", params, nullptr);
+                return;
+            }
+
+            // Resolve the detector once, every subscriber is then a single hash lookup.
+            auto route = table->byIndex.find(index);
+            const EventFilterTable::Routes* routes = (route != table->byIndex.end()) ? &route->second : nullptr;
+            const unsigned char type = eventType.empty() ? 0 : static_cast<unsigned char>(eventType[0]);
+
+            auto wants = [&table, routes, type](const string& designator) -> bool {
+                if (table->filtered.find(designator) == table->filtered.end()) {
+                    return true;
+                }
+                if (routes != nullptr) {
+                    auto subscriber = routes->find(designator);
+                    if (subscriber != routes->end()) {
+                        return subscriber->second.test(type);
+                    }
+                }
+                auto subscriber = table->anyIndex.find(designator);
+                return ((subscriber != table->anyIndex.end()) && subscriber->second.test(type));
+            };
+
+            notifyClients("onMotionEvent", params, [&table, &wants](const string& designator) -> bool {
+                return ((table->compact.find(designator) == table->compact.end()) && wants(designator));
+            });
+
+            // Each subscriber gets one payload, the record is only built when a compact client
+            // takes this event.
+            bool compactWanted = false;
+            for (auto& designator : table->compact) {
+                if (wants(designator)) {
+                    compactWanted = true;
+                    break;
+                }
+            }
+            string encoded;
+            if (compactWanted && encodeMotionRecord(index, eventType, count, firstTime, lastTime, encoded)) {
+                JsonObject record;
+                record["record"] = encoded;
+                notifyClients("onMotionEvent", record, [&table, &wants](const string& designator) -> bool {
+                    return ((table->compact.find(designator) != table->compact.end()) && wants(designator));
+                });
+            }
+        }
+
+        std::shared_ptr<const MotionDetection::CapabilityTable> MotionDetection::capabilities()
+        {
+            if (m_capabilitiesStale.load(std::memory_order_acquire)) {
+                loadCapabilities();
+            }
+            std::lock_guard<std::mutex> lock(m_capabilitiesMutex);
+            return m_capabilities;
+        }
+
+        bool MotionDetection::loadCapabilities()
+        {
+            MOTION_DETECTION_CurrentSensorSettings_t motionDetectors;
+            memset(&motionDetectors, 0, sizeof(motionDetectors));
+
+            uint64_t start = steadyClockNanoseconds();
+            MOTION_DETECTION_Result_t rc = MOTION_DETECTION_GetMotionDetectors(&motionDetectors);
+            recordHalLatency(HAL_GET_MOTION_DETECTORS, start);
+            if (rc != MOTION_DETECTION_RESULT_SUCCESS) {
+                LOGERR("Failed to fetch list of motion detectors..!");
+                return false;
+            }
+
+            // The HAL currently reports a single detector per call, the table and the
+            // response are built for any number of them.
+            std::shared_ptr<CapabilityTable> table = std::make_shared<CapabilityTable>();
+            table->detectors.push_back(motionDetectors);
+
+            JsonArray dectectorList;
+            JsonObject detectorInfo;
+            for (auto& detector : table->detectors) {
+                JsonObject sensorData;
+                sensorData["description"] = string(detector.m_sensorDescription);
+                sensorData["type"] = string(detector.m_sensorType);
+                sensorData["distance"] = std::to_string(detector.m_sensorDistance);
+                sensorData["angle"] = std::to_string(detector.m_sensorAngle);
+                sensorData["sensitivityMode"] = std::to_string(detector.m_sensitivityMode);
+                if (detector.m_sensitivityMode == SENSITIVITY_MODE_LEVELS) {
+                    std::vector<std::string> sensitivityIdentifiers;
+                    for (int identifiers = 0; identifiers < SENSITIVITY_IDENTIFIERS; identifiers++) {
+                        sensitivityIdentifiers.push_back(string(detector.m_sensitivity[identifiers]));
+                    }
+                    setResponseArray(sensorData, "sensitivities", sensitivityIdentifiers);
+                }
+                else if (detector.m_sensitivityMode == SENSITIVITY_MODE_INT) {
+                    sensorData["min"] = string(detector.m_sensitivity[SENSITIVITY_IDENTIFIER_1]);
+                    sensorData["max"] = string(detector.m_sensitivity[SENSITIVITY_IDENTIFIER_1]);
+                    sensorData["step"] = string(detector.m_sensitivity[SENSITIVITY_IDENTIFIER_1]);
+                }
+                detectorInfo[detector.m_sensorIndex] = sensorData;
+                dectectorList.Add(std::string(detector.m_sensorIndex));
+
+                int slot = detectorSlot(detector.m_sensorIndex, true);
+                if (slot >= 0) {
+                    m_detectors[slot].known.store(true, std::memory_order_relaxed);
+                }
+            }
+            table->response["supportedMotionDetectors"] = dectectorList;
+            table->response["supportedMotionDetectorsInfo"] = detectorInfo;
+
+            std::lock_guard<std::mutex> lock(m_capabilitiesMutex);
+            m_capabilities = table;
+            m_capabilitiesStale.store(false, std::memory_order_release);
+            return true;
+        }
+
+        int MotionDetection::detectorSlot(const char* index, bool create)
+        {
+            if ((index == nullptr) || (index[0] == '\0')) {
+                return -1;
+            }
+
+            uint32_t count = m_detectorCount.load(std::memory_order_acquire);
+            for (uint32_t slot = 0; slot < count; slot++) {
+                if (strncmp(m_detectors[slot].index, index, MAX_INDEX_LENGTH) == 0) {
+                    return static_cast<int>(slot);
+                }
+            }
+
+            if (!create || (strlen(index) >= MAX_INDEX_LENGTH)) {
+                return -1;
+            }
+
+            std::lock_guard<std::mutex> lock(m_detectorsMutex);
+
+            // Another thread may have added it while we were waiting for the lock.
+            count = m_detectorCount.load(std::memory_order_relaxed);
+            for (uint32_t slot = 0; slot < count; slot++) {
+                if (strncmp(m_detectors[slot].index, index, MAX_INDEX_LENGTH) == 0) {
+                    return static_cast<int>(slot);
+                }
+            }
+            if (count >= MAX_DETECTORS) {
+                LOGERR("Too many motion detectors, '%s' is not tracked", index);
+                return -1;
+            }
+
+            DetectorState& detector = m_detectors[count];
+            strncpy(detector.index, index, MAX_INDEX_LENGTH - 1);
+            detector.index[MAX_INDEX_LENGTH - 1] = '\0';
+            detector.coalescingWindow.store(m_defaultCoalescingWindow, std::memory_order_relaxed);
+            detector.pending = false;
+            detector.lastEventTime.store(0, std::memory_order_relaxed);
+            detector.presence.store(OCCUPANCY_UNCERTAIN, std::memory_order_relaxed);
+            detector.presenceSince.store(0, std::memory_order_relaxed);
+            detector.presenceTracked = false;
+            detector.known.store(false, std::memory_order_relaxed);
+            detector.settings.noMotionPeriodValid = false;
+            detector.settings.sensitivityValid = false;
+            detector.settings.armStateValid = false;
+            detector.settings.armModeValid = false;
+            m_detectorCount.store(count + 1, std::memory_order_release);
+            return static_cast<int>(count);
+        }
+
+        bool MotionDetection::enqueueEvent(const MOTION_DETECTION_EventMessage_t& eventMsg)
+        {
+            MotionEventRecord record;
+            record.message = eventMsg;
+            record.timestamp = steadyClockNanoseconds();
+
+            bool queued = m_eventQueue.Push(record);
+
+            // Pairs with the fence in dispatchEvents(): either the dispatcher sees the new
+            // record before going to sleep, or we see it idle and wake it up.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (queued && m_dispatcherIdle.load(std::memory_order_relaxed)) {
+                std::lock_guard<std::mutex> lock(m_dispatcherMutex);
+                m_dispatcherCondition.notify_one();
+            }
+            return queued;
+        }
+
+        void MotionDetection::startDispatcher()
+        {
+            std::lock_guard<std::mutex> lock(m_dispatcherMutex);
+            if (!m_dispatcherRunning) {
+                // The dispatcher owns the occupancy state, start it over from uncertain.
+                m_occupancyWheel.Reset(steadyClockNanoseconds());
+                for (uint32_t slot = 0; slot < m_detectorCount.load(std::memory_order_acquire); slot++) {
+                    m_detectors[slot].presenceTracked = false;
+                }
+                m_dispatcherRunning = true;
+                m_dispatcher = std::thread(&MotionDetection::dispatchEvents, this);
+            }
+        }
+
+        void MotionDetection::stopDispatcher()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_dispatcherMutex);
+                m_dispatcherRunning = false;
+                m_dispatcherCondition.notify_one();
+            }
+            if (m_dispatcher.joinable()) {
+                m_dispatcher.join();
+            }
+        }
+
+        void MotionDetection::dispatchEvents()
+        {
+            MotionEventRecord record;
+
+            while (true) {
+                while (m_eventQueue.Pop(record)) {
+                    dispatchEvent(record);
+                }
+                reportQueueDrops();
+
+                uint64_t now = steadyClockNanoseconds();
+                uint64_t deadline = flushCoalescedEvents(now);
+                uint64_t occupancyDeadline = advanceOccupancy(now);
+                if ((occupancyDeadline != 0) && ((deadline == 0) || (occupancyDeadline < deadline))) {
+                    deadline = occupancyDeadline;
+                }
+
+                std::unique_lock<std::mutex> lock(m_dispatcherMutex);
+                if (!m_dispatcherRunning) {
+                    lock.unlock();
+                    // Do not lose events that are still waiting for their window to close.
+                    flushCoalescedEvents(UINT64_MAX);
+                    break;
+                }
+                m_dispatcherIdle.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (m_eventQueue.IsEmpty()) {
+                    if (deadline != 0) {
+                        m_dispatcherCondition.wait_until(lock, std::chrono::steady_clock::time_point(std::chrono::nanoseconds(deadline)));
+                    } else {
+                        m_dispatcherCondition.wait(lock);
+                    }
+                }
+                m_dispatcherIdle.store(false, std::memory_order_relaxed);
+            }
+        }
+
+        void MotionDetection::dispatchEvent(const MotionEventRecord& record)
+        {
+            if (m_recording.load(std::memory_order_relaxed)) {
+                recordEvent(record);
+            }
+            m_lastEventTime.store(record.timestamp, std::memory_order_relaxed);
+
+            int slot = detectorSlot(record.message.m_sensorIndex, true);
+            if (slot >= 0) {
+                DetectorState& detector = m_detectors[slot];
+                detector.lastEventTime.store(record.timestamp, std::memory_order_relaxed);
+                occupancyActivity(static_cast<uint32_t>(slot), record.timestamp, static_cast<char>(record.message.m_eventType));
+                if (!detector.known.exchange(true, std::memory_order_relaxed)) {
+                    // Events from a detector we have no capabilities for mean the set of
+                    // detectors changed (hotplug), rebuild the table once on the next request.
+                    m_capabilitiesStale.store(true, std::memory_order_release);
+                }
+                detector.history.Add(record.timestamp, static_cast<int32_t>(record.message.m_eventType));
+
+                uint32_t window = detector.coalescingWindow.load(std::memory_order_relaxed);
+                if ((window != 0) || detector.pending) {
+                    coalesceEvent(detector, record, window);
+                    return;
+                }
+            }
+
+            string index(record.message.m_sensorIndex);
+            string eventType(1, record.message.m_eventType);
+            onMotionEvent(index, eventType);
+            m_eventLatency.Record((steadyClockNanoseconds() - record.timestamp) / 1000ULL);
+        }
+
+        void MotionDetection::recordEvent(const MotionEventRecord& record)
+        {
+            std::lock_guard<std::mutex> lock(m_recordingMutex);
+            if (m_recordingLog.IsOpen() && !m_recordingLog.Write(record.timestamp,
+                    static_cast<char>(record.message.m_eventType), record.message.m_sensorIndex)) {
+                LOGERR("Failed to write event recording '%s', recording stopped", m_recordingPath.c_str());
+                m_recording.store(false, std::memory_order_relaxed);
+                m_recordingLog.Close();
+            }
+        }
+
+        void MotionDetection::coalesceEvent(DetectorState& detector, const MotionEventRecord& record, uint32_t window)
+        {
+            int32_t eventType = static_cast<int32_t>(record.message.m_eventType);
+
+            // A change of event type always closes the current window, clients must not
+            // miss a motion/no-motion transition.
+            if (detector.pending && ((detector.pendingType != eventType) || (window == 0))) {
+                flushCoalescedEvent(detector);
+            }
+
+            if (!detector.pending) {
+                detector.pending = true;
+                detector.pendingType = eventType;
+                detector.pendingCount = 0;
+                detector.pendingFirst = record.timestamp;
+                detector.pendingDeadline = record.timestamp + (static_cast<uint64_t>(window) * 1000000ULL);
+            }
+            detector.pendingCount++;
+            detector.pendingLast = record.timestamp;
+
+            if (window == 0) {
+                flushCoalescedEvent(detector);
+            }
+        }
+
+        void MotionDetection::flushCoalescedEvent(DetectorState& detector)
+        {
+            detector.pending = false;
+
+            string index(detector.index);
+            string eventType(1, static_cast<char>(detector.pendingType));
+            onMotionEvent(index, eventType, detector.pendingCount, detector.pendingFirst / 1000000ULL, detector.pendingLast / 1000000ULL);
+        }
+
+        uint64_t MotionDetection::flushCoalescedEvents(uint64_t now)
+        {
+            uint64_t nextDeadline = 0;
+            uint32_t count = m_detectorCount.load(std::memory_order_acquire);
+
+            for (uint32_t slot = 0; slot < count; slot++) {
+                DetectorState& detector = m_detectors[slot];
+                if (!detector.pending) {
+                    continue;
+                }
+                if (detector.pendingDeadline <= now) {
+                    flushCoalescedEvent(detector);
+                } else if ((nextDeadline == 0) || (detector.pendingDeadline < nextDeadline)) {
+                    nextDeadline = detector.pendingDeadline;
+                }
+            }
+            return nextDeadline;
+        }
+
+        uint64_t MotionDetection::occupancyTimeout(DetectorState& detector)
+        {
+            uint64_t timeout = m_occupancyTimeout;
+            {
+                // The no motion period, when known, is the detector's own notion of "gone".
+                std::lock_guard<std::mutex> lock(detector.settingsLock);
+                if (detector.settings.noMotionPeriodValid && (detector.settings.noMotionPeriod > 0)) {
+                    timeout = detector.settings.noMotionPeriod;
+                }
+            }
+            return timeout * 1000000000ULL;
+        }
+
+        void MotionDetection::setPresence(DetectorState& detector, int state, uint64_t now)
+        {
+            int previous = detector.presence.load(std::memory_order_relaxed);
+            if (previous != state) {
+                detector.presence.store(state, std::memory_order_relaxed);
+                detector.presenceSince.store(now, std::memory_order_relaxed);
+                onPresenceChanged(string(detector.index), state, previous);
+            }
+        }
+
+        void MotionDetection::trackOccupancy(uint32_t slot, uint64_t now)
+        {
+            DetectorState& detector = m_detectors[slot];
+            if (!detector.presenceTracked) {
+                // Nothing is known until the first event, absent if none arrives in time.
+                detector.presenceTracked = true;
+                detector.presence.store(OCCUPANCY_UNCERTAIN, std::memory_order_relaxed);
+                detector.presenceSince.store(now, std::memory_order_relaxed);
+                m_occupancyWheel.Schedule(slot, now + occupancyTimeout(detector));
+            }
+        }
+
+        void MotionDetection::occupancyActivity(uint32_t slot, uint64_t timestamp, char eventType)
+        {
+            DetectorState& detector = m_detectors[slot];
+            detector.presenceTracked = true;
+
+            if (eventType != NO_MOTION_EVENT) {
+                setPresence(detector, OCCUPANCY_PRESENT, timestamp);
+                m_occupancyWheel.Schedule(slot, timestamp + occupancyTimeout(detector));
+                return;
+            }
+
+            // The detector reports the room empty: presence is no longer certain, and absent
+            // once a timeout passes without motion. A running timeout is not extended.
+            int presence = detector.presence.load(std::memory_order_relaxed);
+            if (presence == OCCUPANCY_PRESENT) {
+                setPresence(detector, OCCUPANCY_UNCERTAIN, timestamp);
+                m_occupancyWheel.Schedule(slot, timestamp + occupancyTimeout(detector));
+            } else if ((presence == OCCUPANCY_UNCERTAIN) && !m_occupancyWheel.IsScheduled(slot)) {
+                m_occupancyWheel.Schedule(slot, timestamp + occupancyTimeout(detector));
+            }
+        }
+
+        void MotionDetection::occupancyExpired(uint32_t slot, uint64_t now)
+        {
+            DetectorState& detector = m_detectors[slot];
+            if (detector.presence.load(std::memory_order_relaxed) == OCCUPANCY_PRESENT) {
+                setPresence(detector, OCCUPANCY_UNCERTAIN, now);
+                m_occupancyWheel.Schedule(slot, now + occupancyTimeout(detector));
+            } else {
+                setPresence(detector, OCCUPANCY_ABSENT, now);
+            }
+        }
+
+        uint64_t MotionDetection::advanceOccupancy(uint64_t now)
+        {
+            uint32_t count = m_detectorCount.load(std::memory_order_acquire);
+            for (uint32_t slot = 0; slot < count; slot++) {
+                trackOccupancy(slot, now);
+            }
+
+            auto expired = [this, now](uint32_t slot) { occupancyExpired(slot, now); };
+            m_occupancyWheel.Advance(now, expired);
+            return m_occupancyWheel.NextExpiry();
+        }
+
+        void MotionDetection::reportQueueDrops()
+        {
+            uint32_t dropped = m_eventQueue.Dropped();
+            if (dropped != m_reportedDrops) {
+                LOGWARN("Event queue overflow: %u motion events dropped (total %u, high-water mark %u of %u)",
+                    dropped - m_reportedDrops, dropped, m_eventQueue.HighWaterMark(), m_eventQueue.Capacity());
+                m_reportedDrops = dropped;
+            }
         }
-        //End events
 
     } // namespace Plugin
 } // namespace WPEFramework
@@ -20,8 +20,29 @@
 #pragma once
 
 #include <chrono>
+#include <atomic>
+#include <bitset>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <set>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include "Module.h"
 #include "motionDetector.h"
+#include "MotionEventQueue.h"
+#include "MotionEventHistory.h"
+#include "MotionEventLog.h"
+#include "ActivePeriod.h"
+#include "TimerWheel.h"
+#include "LatencyHistogram.h"
+#include "tptimer.h"
 
 namespace WPEFramework {
 
@@ -45,6 +66,222 @@ namespace WPEFramework {
             typedef Core::JSON::ArrayType<JString> JStringArray;
             typedef Core::JSON::Boolean JBool;
 
+            // Raw HAL event as captured on the md-hal callback thread.
+            struct MotionEventRecord {
+                MOTION_DETECTION_EventMessage_t message;
+                uint64_t timestamp; // steady clock, nanoseconds
+            };
+            static constexpr uint32_t EVENT_QUEUE_CAPACITY = 256;
+            static constexpr uint32_t EVENT_HISTORY_CAPACITY = 64;
+            static constexpr uint32_t MAX_DETECTORS = 8;
+            static constexpr uint32_t MAX_INDEX_LENGTH = 32;
+            static constexpr uint32_t MAX_COALESCING_WINDOW = 60000; // milliseconds
+            static constexpr uint32_t OCCUPANCY_WHEEL_SLOTS = 64;
+            static constexpr uint64_t OCCUPANCY_WHEEL_RESOLUTION = 100000000ULL; // 100 ms, in nanoseconds
+            static constexpr uint32_t DEFAULT_OCCUPANCY_TIMEOUT = 60; // seconds
+            static constexpr uint32_t DEFAULT_TELEMETRY_INTERVAL = 60; // seconds
+            static constexpr uint32_t DEFAULT_READY_TIMEOUT = 2000; // milliseconds
+            static constexpr uint32_t DEFAULT_RECONCILE_INTERVAL = 300; // seconds
+
+            // md-hal calls with a latency histogram, see getPerformanceMetrics.
+            enum HalCall {
+                HAL_ARM = 0,
+                HAL_DISARM,
+                HAL_IS_ARMED,
+                HAL_SET_NO_MOTION_PERIOD,
+                HAL_GET_NO_MOTION_PERIOD,
+                HAL_SET_SENSITIVITY,
+                HAL_GET_SENSITIVITY,
+                HAL_SET_ACTIVE_PERIOD,
+                HAL_GET_ACTIVE_PERIOD,
+                HAL_GET_MOTION_DETECTORS,
+                HAL_CALL_COUNT
+            };
+
+            enum OccupancyState {
+                OCCUPANCY_ABSENT = 0,
+                OCCUPANCY_UNCERTAIN,
+                OCCUPANCY_PRESENT
+            };
+
+            class Config : public Core::JSON::Container {
+            private:
+                Config(const Config&) = delete;
+                Config& operator=(const Config&) = delete;
+
+            public:
+                Config()
+                    : Core::JSON::Container()
+                    , EventCoalescingWindow(0)
+                    , OccupancyTimeout(DEFAULT_OCCUPANCY_TIMEOUT)
+                    , TelemetryInterval(DEFAULT_TELEMETRY_INTERVAL)
+                    , AsyncInit(false)
+                    , ReadyTimeout(DEFAULT_READY_TIMEOUT)
+                    , RecordingPath()
+                    , ReconcileInterval(DEFAULT_RECONCILE_INTERVAL)
+                {
+                    Add(_T("eventcoalescingwindow"), &EventCoalescingWindow);
+                    Add(_T("occupancytimeout"), &OccupancyTimeout);
+                    Add(_T("telemetryinterval"), &TelemetryInterval);
+                    Add(_T("asyncinit"), &AsyncInit);
+                    Add(_T("readytimeout"), &ReadyTimeout);
+                    Add(_T("recordingpath"), &RecordingPath);
+                    Add(_T("reconcileinterval"), &ReconcileInterval);
+                    Add(_T("schedulepath"), &SchedulePath);
+                }
+                ~Config() = default;
+
+            public:
+                Core::JSON::DecUInt32 EventCoalescingWindow;
+                Core::JSON::DecUInt32 OccupancyTimeout;
+                Core::JSON::DecUInt32 TelemetryInterval;
+                Core::JSON::Boolean AsyncInit;
+                Core::JSON::DecUInt32 ReadyTimeout;
+                Core::JSON::String RecordingPath;
+                Core::JSON::DecUInt32 ReconcileInterval;
+                Core::JSON::String SchedulePath;
+            };
+
+            // Capabilities of every detector reported by the HAL, together with the
+            // getMotionDetectors response built from them. Never modified once published,
+            // a reload builds a new table and swaps the pointer.
+            struct CapabilityTable {
+                std::vector<MOTION_DETECTION_CurrentSensorSettings_t> detectors;
+                JsonObject response;
+            };
+
+            // onMotionEvent options of one client, set with setEventFilter and setEventEncoding.
+            // An empty index set accepts every detector; the mask holds one bit per event type
+            // character. Compact clients get the event as a packed base64 record. Only the
+            // connection (channel) that created the entry can change or remove it.
+            struct EventFilter {
+                std::set<string> indexes;
+                std::bitset<256> eventTypes;
+                bool compact;
+                uint32_t channel;
+            };
+
+            // Routing table derived from all event filters. Like the capability table it is
+            // never modified once published, every filter change builds a new one.
+            struct EventFilterTable {
+                typedef std::unordered_map<string, std::bitset<256>> Routes;
+
+                // Filtered clients interested in a detector, with the event types they accept.
+                std::map<string, Routes> byIndex;
+                // Filtered clients that accept every detector.
+                Routes anyIndex;
+                // Clients without an entry here are not filtered and get every event.
+                std::unordered_set<string> filtered;
+                // Clients that asked for the compact encoding.
+                std::unordered_set<string> compact;
+            };
+
+            // Last known HAL settings of a detector, written through by the setters.
+            struct SettingsCache {
+                bool noMotionPeriodValid;
+                unsigned int noMotionPeriod;
+                bool sensitivityValid;
+                int sensitivityMode;
+                std::string sensitivity;
+                // Arm state as set by arm/disarm, checked against md-hal by the reconciliation
+                // timer. md-hal cannot report the mode a detector was armed with, remember it.
+                bool armStateValid;
+                bool armed;
+                bool armModeValid;
+                int armMode;
+            };
+
+            // One entry of a configureDetectors request.
+            struct DetectorConfiguration {
+                string index;
+                bool arm;
+                int mode;
+                bool disarm;
+                bool hasPeriod;
+                unsigned int period;
+                bool hasSensitivity;
+                string sensitivity;
+                int sensitivityMode;
+                bool hasActivePeriod;
+                unsigned int nowTime;
+                ActivePeriod activePeriod;
+            };
+
+            // HAL state captured before configureDetectors changed a setting. Not restorable:
+            // the previous value could not be read, a rollback cannot undo the change.
+            // Restored is set by the rollback.
+            struct ConfigurationUndo {
+                enum Setting { ARM_STATE, NO_MOTION_PERIOD, SENSITIVITY, ACTIVE_PERIOD };
+
+                Setting setting;
+                bool restorable;
+                bool restored;
+                string index;
+                bool armed;
+                bool modeValid;
+                int mode;
+                unsigned int period;
+                string sensitivity;
+                int sensitivityMode;
+                unsigned int nowTime;
+                ActivePeriod activePeriod;
+            };
+
+            // Arm schedule of one detector, see setArmSchedule: armed with mode inside the
+            // period, disarmed outside of it. The generation tells transitions still queued
+            // for a replaced or cleared schedule apart.
+            struct ArmSchedule {
+                ActivePeriod period;
+                int mode;
+                uint32_t generation;
+            };
+
+            // Next change of the arm state of a schedule, in wall clock seconds.
+            struct ArmTransition {
+                uint64_t due;
+                string index;
+                uint32_t generation;
+
+                bool operator>(const ArmTransition& other) const
+                {
+                    return (due > other.due);
+                }
+            };
+
+            // Per detector state, looked up by the HAL index string (e.g. "FP_MD").
+            // Slots are only ever added, never removed, so a slot number stays valid for
+            // the lifetime of the plugin instance.
+            struct DetectorState {
+                char index[MAX_INDEX_LENGTH];
+                // Set once the detector has been taken into account by the capability table.
+                std::atomic<bool> known;
+                MotionEventHistory<EVENT_HISTORY_CAPACITY> history;
+                // Steady clock nanoseconds of the last event, 0 if there was none yet.
+                std::atomic<uint64_t> lastEventTime;
+
+                // Coalescing window in milliseconds, 0 sends every event on its own.
+                std::atomic<uint32_t> coalescingWindow;
+
+                // Window being accumulated, only touched by the dispatcher thread.
+                bool pending;
+                int32_t pendingType;
+                uint32_t pendingCount;
+                uint64_t pendingFirst;
+                uint64_t pendingLast;
+                uint64_t pendingDeadline;
+
+                // Occupancy derived from the events: present after motion, uncertain after a no
+                // motion event or once the timeout passed without motion, absent after a further
+                // timeout. The state is
+                // written by the dispatcher thread only; presenceTracked is dispatcher-only.
+                std::atomic<int> presence;
+                std::atomic<uint64_t> presenceSince;
+                bool presenceTracked;
+
+                std::mutex settingsLock;
+                SettingsCache settings;
+            };
+
             // We do not allow this plugin to be copied !!
             MotionDetection(const MotionDetection&) = delete;
             MotionDetection& operator=(const MotionDetection&) = delete;
@@ -61,6 +298,19 @@ namespace WPEFramework {
             uint32_t getLastMotionEventElapsedTime(const JsonObject& parameters, JsonObject& response);
             uint32_t setMotionEventsActivePeriod(const JsonObject& parameters, JsonObject& response);
             uint32_t getMotionEventsActivePeriod(const JsonObject& parameters, JsonObject& response);
+            uint32_t isMotionEventsActive(const JsonObject& parameters, JsonObject& response);
+            uint32_t getPresence(const JsonObject& parameters, JsonObject& response);
+            uint32_t getMotionEventHistory(const JsonObject& parameters, JsonObject& response);
+            uint32_t setEventCoalescing(const JsonObject& parameters, JsonObject& response);
+            uint32_t refresh(const JsonObject& parameters, JsonObject& response);
+            uint32_t configureDetectors(const JsonObject& parameters, JsonObject& response);
+            uint32_t setEventFilter(const uint32_t channel, const JsonObject& parameters, JsonObject& response);
+            uint32_t setEventEncoding(const uint32_t channel, const JsonObject& parameters, JsonObject& response);
+            uint32_t getPerformanceMetrics(const JsonObject& parameters, JsonObject& response);
+            uint32_t resetPerformanceMetrics(const JsonObject& parameters, JsonObject& response);
+            uint32_t setEventRecording(const JsonObject& parameters, JsonObject& response);
+            uint32_t setArmSchedule(const JsonObject& parameters, JsonObject& response);
+            uint32_t getArmSchedule(const JsonObject& parameters, JsonObject& response);
             //End methods
 
         public:
@@ -80,12 +330,156 @@ namespace WPEFramework {
 
             //Begin events
             void onMotionEvent(const string& index, const string& eventType);
+            void onMotionEvent(const string& index, const string& eventType, uint32_t count, uint64_t firstTime, uint64_t lastTime);
+            void onPresenceChanged(const string& index, int state, int previousState);
+            void onReady();
             //End events
+
+            bool enqueueEvent(const MOTION_DETECTION_EventMessage_t& eventMsg);
+
         public:
-            static MotionDetection* _instance;
+            // Published by Initialize for the md-hal callback. Deinitialize retires it and then
+            // waits until _callbacks, the callbacks still using it, drops to 0; the last of them
+            // signals _drained.
+            static std::atomic<MotionDetection*> _instance;
+            static std::atomic<uint32_t> _callbacks;
+            static std::mutex _drainLock;
+            static std::condition_variable _drained;
 
         private:
-            std::chrono::system_clock::time_point m_lastEventTime;
+            void initializeHal();
+            bool waitUntilReady();
+            int detectorSlot(const char* index, bool create);
+            std::shared_ptr<const CapabilityTable> capabilities();
+            bool loadCapabilities();
+            bool parseActivePeriod(const JsonObject& parameters, unsigned int& nowTime, ActivePeriod& activePeriod);
+            MOTION_DETECTION_Result_t applyArm(const string& index, int mode);
+            MOTION_DETECTION_Result_t applyDisarm(const string& index);
+            MOTION_DETECTION_Result_t applyNoMotionPeriod(const string& index, unsigned int period);
+            MOTION_DETECTION_Result_t applySensitivity(const string& index, const string& sensitivity, int mode);
+            MOTION_DETECTION_Result_t applyActivePeriod(const string& index, unsigned int nowTime, const ActivePeriod& activePeriod);
+            string parseDetectorConfiguration(const JsonObject& parameters, DetectorConfiguration& configuration);
+            bool applyDetectorConfiguration(const DetectorConfiguration& configuration, std::vector<ConfigurationUndo>& undoLog, string& error);
+            bool rollbackConfiguration(std::vector<ConfigurationUndo>& undoLog);
+            MOTION_DETECTION_Result_t readArmState(const string& index, bool& armed, bool cached);
+            void reconcileArmStates();
+            MOTION_DETECTION_Result_t applyArmSchedule(const string& index, bool active, int mode);
+            void queueArmTransition(const string& index, const ArmSchedule& schedule, uint64_t now);
+            void restoreArmSchedule(const string& index, bool replaced, const ArmSchedule& previous);
+            void startArmScheduleTimer();
+            void runArmSchedules();
+            void loadArmSchedules();
+            bool saveArmSchedules();
+            MOTION_DETECTION_Result_t readNoMotionPeriod(const string& index, unsigned int& period, bool cached);
+            MOTION_DETECTION_Result_t readSensitivity(const string& index, string& sensitivity, int& mode, bool cached);
+            MOTION_DETECTION_Result_t readActivePeriod(ActivePeriod& activePeriod, bool cached);
+            void startDispatcher();
+            void stopDispatcher();
+            void dispatchEvents();
+            void dispatchEvent(const MotionEventRecord& record);
+            void recordEvent(const MotionEventRecord& record);
+            void coalesceEvent(DetectorState& detector, const MotionEventRecord& record, uint32_t window);
+            void flushCoalescedEvent(DetectorState& detector);
+            uint64_t flushCoalescedEvents(uint64_t now);
+            void reportQueueDrops();
+            void trackOccupancy(uint32_t slot, uint64_t now);
+            void occupancyActivity(uint32_t slot, uint64_t timestamp, char eventType);
+            void occupancyExpired(uint32_t slot, uint64_t now);
+            uint64_t advanceOccupancy(uint64_t now);
+            uint64_t occupancyTimeout(DetectorState& detector);
+            void setPresence(DetectorState& detector, int state, uint64_t now);
+            static const char* presenceName(int state);
+            void recordHalLatency(HalCall call, uint64_t start);
+            static const char* halCallName(int call);
+            void countMotionTelemetry(uint32_t count);
+            void flushTelemetry();
+            void publishEventFilters();
+            uint32_t invokeFromChannel(uint32_t (MotionDetection::*method)(const uint32_t, const JsonObject&, JsonObject&),
+                const uint32_t channel, const string& parameters, string& result);
+            void notifyClients(const char* event, const JsonObject& params, const std::function<bool(const string&)>& accept);
+            void notifyMotionEvent(const string& index, const string& eventType, const JsonObject& params, uint32_t count, uint64_t firstTime, uint64_t lastTime);
+
+        private:
+            // Set once md-hal bring-up completed. With asyncinit the bring-up runs on
+            // m_initThread and methods wait up to m_readyTimeout ms for it.
+            std::atomic<bool> m_halReady;
+            std::mutex m_readyMutex;
+            std::condition_variable m_readyCondition;
+            std::thread m_initThread;
+            bool m_asyncInit;
+            uint32_t m_readyTimeout;
+
+            // Steady clock nanoseconds of the last event of any detector, and of Initialize.
+            std::atomic<uint64_t> m_lastEventTime;
+            std::atomic<uint64_t> m_startTime;
+
+            MotionEventQueue<MotionEventRecord, EVENT_QUEUE_CAPACITY> m_eventQueue;
+            std::thread m_dispatcher;
+            std::mutex m_dispatcherMutex;
+            std::condition_variable m_dispatcherCondition;
+            std::atomic<bool> m_dispatcherIdle;
+            bool m_dispatcherRunning;
+            uint32_t m_reportedDrops;
+
+            DetectorState m_detectors[MAX_DETECTORS];
+            std::atomic<uint32_t> m_detectorCount;
+            std::mutex m_detectorsMutex;
+            uint32_t m_defaultCoalescingWindow;
+
+            // Occupancy timers of all detectors, owned by the dispatcher thread.
+            TimerWheel<OCCUPANCY_WHEEL_SLOTS, MAX_DETECTORS> m_occupancyWheel;
+            uint32_t m_occupancyTimeout;
+
+            std::shared_ptr<const CapabilityTable> m_capabilities;
+            std::atomic<bool> m_capabilitiesStale;
+            std::mutex m_capabilitiesMutex;
+
+            // md-hal keeps a single active period for all detectors.
+            std::mutex m_activePeriodMutex;
+            bool m_activePeriodValid;
+            ActivePeriod m_activePeriod;
+
+            // Event filters and encodings by client designator, and the routing table built from them.
+            // m_eventFilterTable is null while no client has a filter.
+            std::mutex m_eventFiltersMutex;
+            std::map<string, EventFilter> m_eventFilters;
+            std::shared_ptr<const EventFilterTable> m_eventFilterTable;
+
+            // Motion events not reported to telemetry yet. They are summed into a single
+            // t2_event_d every m_telemetryInterval seconds (0 reports every event inline).
+            std::atomic<uint32_t> m_telemetryMotionEvents;
+            uint32_t m_telemetryInterval;
+            TpTimer m_telemetryTimer;
+
+            // Duration of every md-hal call, and the time from the HAL callback until the
+            // onMotionEvent notification was sent (uncoalesced events only).
+            LatencyHistogram m_halLatency[HAL_CALL_COUNT];
+            LatencyHistogram m_eventLatency;
+
+            // Raw HAL event stream written to m_recordingPath by the dispatcher while
+            // recording is enabled, see setEventRecording.
+            std::atomic<bool> m_recording;
+            std::mutex m_recordingMutex;
+            MotionEventLogWriter m_recordingLog;
+            string m_recordingPath;
+
+            // Periodic check of the cached arm states against md-hal, every
+            // m_reconcileInterval seconds (0 disables it). Differences are counted. A pass
+            // holds m_reconcileMutex while it uses md-hal.
+            uint32_t m_reconcileInterval;
+            TpTimer m_reconcileTimer;
+            std::mutex m_reconcileMutex;
+            std::atomic<uint32_t> m_armStateDrift;
+
+            // Arm schedules by detector index, persisted to m_schedulePath (empty: not
+            // persisted). The next transition of every schedule is queued in m_armTransitions,
+            // earliest first, and m_scheduleTimer only runs for the head of that queue.
+            std::mutex m_scheduleMutex;
+            std::map<string, ArmSchedule> m_armSchedules;
+            std::priority_queue<ArmTransition, std::vector<ArmTransition>, std::greater<ArmTransition>> m_armTransitions;
+            uint32_t m_scheduleGeneration;
+            TpTimer m_scheduleTimer;
+            string m_schedulePath;
         };
 	} // namespace Plugin
 } // namespace WPEFramework
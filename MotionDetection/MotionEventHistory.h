@@ -0,0 +1,140 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2026 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace WPEFramework {
+
+    namespace Plugin {
+
+        // Fixed capacity history of motion events for one detector.
+        // Entries are appended in timestamp order (single writer, the dispatcher thread), so
+        // the ring is always sorted and time-range queries are a binary search over it.
+        template <uint32_t CAPACITY>
+        class MotionEventHistory {
+            static_assert((CAPACITY >= 2) && ((CAPACITY & (CAPACITY - 1)) == 0), "CAPACITY must be a power of two");
+
+        public:
+            struct Entry {
+                uint64_t timestamp; // steady clock, nanoseconds
+                int32_t eventType;
+            };
+
+        private:
+            static constexpr uint32_t Mask = CAPACITY - 1;
+
+            MotionEventHistory(const MotionEventHistory&) = delete;
+            MotionEventHistory& operator=(const MotionEventHistory&) = delete;
+
+        public:
+            MotionEventHistory()
+                : _start(0)
+                , _count(0)
+            {
+            }
+            ~MotionEventHistory() = default;
+
+        public:
+            void Add(const uint64_t timestamp, const int32_t eventType)
+            {
+                std::lock_guard<std::mutex> lock(_lock);
+
+                Entry& entry = _entries[(_start + _count) & Mask];
+                entry.timestamp = timestamp;
+                entry.eventType = eventType;
+
+                if (_count < CAPACITY) {
+                    _count++;
+                } else {
+                    _start = (_start + 1) & Mask;
+                }
+            }
+
+            // Appends the newest limit entries with since <= timestamp <= until, oldest first,
+            // to result. Returns the number of entries added.
+            uint32_t Query(const uint64_t since, const uint64_t until, const uint32_t limit, std::vector<Entry>& result) const
+            {
+                std::lock_guard<std::mutex> lock(_lock);
+
+                const uint32_t first = LowerBound(since);
+                uint32_t end = first;
+                uint32_t high = _count;
+                while (end < high) {
+                    const uint32_t middle = end + ((high - end) / 2);
+                    if (At(middle).timestamp <= until) {
+                        end = middle + 1;
+                    } else {
+                        high = middle;
+                    }
+                }
+
+                const uint32_t added = ((end - first) < limit) ? (end - first) : limit;
+                for (uint32_t position = end - added; position < end; position++) {
+                    result.push_back(At(position));
+                }
+                return added;
+            }
+
+            void Clear()
+            {
+                std::lock_guard<std::mutex> lock(_lock);
+                _start = 0;
+                _count = 0;
+            }
+
+            static constexpr uint32_t Capacity()
+            {
+                return CAPACITY;
+            }
+
+        private:
+            const Entry& At(const uint32_t position) const
+            {
+                return _entries[(_start + position) & Mask];
+            }
+
+            // Position of the first entry with timestamp >= since, _count if there is none.
+            uint32_t LowerBound(const uint64_t since) const
+            {
+                uint32_t low = 0;
+                uint32_t high = _count;
+                while (low < high) {
+                    const uint32_t middle = low + ((high - low) / 2);
+                    if (At(middle).timestamp < since) {
+                        low = middle + 1;
+                    } else {
+                        high = middle;
+                    }
+                }
+                return low;
+            }
+
+        private:
+            mutable std::mutex _lock;
+            uint32_t _start;
+            uint32_t _count;
+            Entry _entries[CAPACITY];
+        };
+
+    } // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,194 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2026 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace WPEFramework {
+
+    namespace Plugin {
+
+        // Binary log of a motion event stream, written by the plugin (setEventRecording) and
+        // replayed by the md-hal simulator (MD_SIM_MODE=replay). All numbers little endian:
+        //
+        //   header: "MDEV", version (uint16, 1), reserved (uint16)
+        //   record: timestamp (uint64, steady clock ns at the HAL callback), event type (uint8),
+        //           index length n (uint8), index (n bytes, no terminator)
+        //
+        // Neither class is thread safe.
+        struct MotionEventLog {
+            static constexpr uint16_t Version = 1;
+            static constexpr uint32_t HeaderSize = 8;
+            static constexpr uint32_t MaxIndexLength = 32;
+
+            struct Entry {
+                uint64_t timestamp;
+                char eventType;
+                char index[MaxIndexLength + 1];
+            };
+        };
+
+        class MotionEventLogWriter {
+        private:
+            MotionEventLogWriter(const MotionEventLogWriter&) = delete;
+            MotionEventLogWriter& operator=(const MotionEventLogWriter&) = delete;
+
+        public:
+            MotionEventLogWriter()
+                : _file(nullptr)
+                , _records(0)
+            {
+            }
+            ~MotionEventLogWriter()
+            {
+                Close();
+            }
+
+        public:
+            bool Open(const std::string& path)
+            {
+                Close();
+                _file = ::fopen(path.c_str(), "wb");
+                if (_file == nullptr) {
+                    return false;
+                }
+                const uint8_t header[MotionEventLog::HeaderSize] = { 'M', 'D', 'E', 'V',
+                    static_cast<uint8_t>(MotionEventLog::Version & 0xFF), static_cast<uint8_t>(MotionEventLog::Version >> 8), 0, 0 };
+                if (::fwrite(header, sizeof(header), 1, _file) != 1) {
+                    Close();
+                    return false;
+                }
+                _records = 0;
+                return true;
+            }
+
+            bool Write(const uint64_t timestamp, const char eventType, const char index[])
+            {
+                if (_file == nullptr) {
+                    return false;
+                }
+                uint8_t record[8 + 2 + MotionEventLog::MaxIndexLength];
+                const size_t indexLength = ::strnlen(index, MotionEventLog::MaxIndexLength);
+                for (int byte = 0; byte < 8; byte++) {
+                    record[byte] = static_cast<uint8_t>(timestamp >> (8 * byte));
+                }
+                record[8] = static_cast<uint8_t>(eventType);
+                record[9] = static_cast<uint8_t>(indexLength);
+                ::memcpy(&record[10], index, indexLength);
+                if (::fwrite(record, 10 + indexLength, 1, _file) != 1) {
+                    return false;
+                }
+                _records++;
+                return true;
+            }
+
+            void Close()
+            {
+                if (_file != nullptr) {
+                    ::fclose(_file);
+                    _file = nullptr;
+                }
+            }
+
+            bool IsOpen() const
+            {
+                return (_file != nullptr);
+            }
+            uint64_t Records() const
+            {
+                return _records;
+            }
+
+        private:
+            FILE* _file;
+            uint64_t _records;
+        };
+
+        class MotionEventLogReader {
+        private:
+            MotionEventLogReader(const MotionEventLogReader&) = delete;
+            MotionEventLogReader& operator=(const MotionEventLogReader&) = delete;
+
+        public:
+            MotionEventLogReader()
+                : _file(nullptr)
+            {
+            }
+            ~MotionEventLogReader()
+            {
+                Close();
+            }
+
+        public:
+            bool Open(const std::string& path)
+            {
+                Close();
+                _file = ::fopen(path.c_str(), "rb");
+                if (_file == nullptr) {
+                    return false;
+                }
+                uint8_t header[MotionEventLog::HeaderSize];
+                if ((::fread(header, sizeof(header), 1, _file) != 1) || (::memcmp(header, "MDEV", 4) != 0)
+                    || ((header[4] | (header[5] << 8)) != MotionEventLog::Version)) {
+                    Close();
+                    return false;
+                }
+                return true;
+            }
+
+            // Returns false at the end of the log, or on a truncated record.
+            bool Read(MotionEventLog::Entry& entry)
+            {
+                uint8_t record[10];
+                if ((_file == nullptr) || (::fread(record, sizeof(record), 1, _file) != 1)) {
+                    return false;
+                }
+                entry.timestamp = 0;
+                for (int byte = 7; byte >= 0; byte--) {
+                    entry.timestamp = (entry.timestamp << 8) | record[byte];
+                }
+                entry.eventType = static_cast<char>(record[8]);
+                const uint8_t indexLength = record[9];
+                if ((indexLength > MotionEventLog::MaxIndexLength)
+                    || ((indexLength > 0) && (::fread(entry.index, indexLength, 1, _file) != 1))) {
+                    return false;
+                }
+                entry.index[indexLength] = '\0';
+                return true;
+            }
+
+            void Close()
+            {
+                if (_file != nullptr) {
+                    ::fclose(_file);
+                    _file = nullptr;
+                }
+            }
+
+        private:
+            FILE* _file;
+        };
+
+    } // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,138 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2026 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace WPEFramework {
+
+    namespace Plugin {
+
+        // Bounded lock-free queue for plain-old-data records.
+        // Push() must only be called from a single producer (the md-hal callback thread),
+        // Pop() may be called from any number of consumer threads. Every cell carries a
+        // sequence number, so consumers claim a cell with a single CAS and the producer
+        // never waits: when the ring is full the record is dropped and counted instead.
+        template <typename RECORD, uint32_t CAPACITY>
+        class MotionEventQueue {
+            static_assert((CAPACITY >= 2) && ((CAPACITY & (CAPACITY - 1)) == 0), "CAPACITY must be a power of two");
+
+        private:
+            static constexpr uint32_t Mask = CAPACITY - 1;
+            static constexpr uint32_t CacheLine = 64;
+
+            struct Cell {
+                std::atomic<uint32_t> sequence;
+                RECORD record;
+            };
+
+            MotionEventQueue(const MotionEventQueue&) = delete;
+            MotionEventQueue& operator=(const MotionEventQueue&) = delete;
+
+        public:
+            MotionEventQueue()
+                : _head(0)
+                , _tail(0)
+                , _dropped(0)
+                , _highWaterMark(0)
+            {
+                for (uint32_t index = 0; index < CAPACITY; index++) {
+                    _cells[index].sequence.store(index, std::memory_order_relaxed);
+                }
+            }
+            ~MotionEventQueue() = default;
+
+        public:
+            bool Push(const RECORD& record)
+            {
+                const uint32_t position = _tail.load(std::memory_order_relaxed);
+                Cell& cell = _cells[position & Mask];
+
+                if (cell.sequence.load(std::memory_order_acquire) != position) {
+                    _dropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+
+                cell.record = record;
+                cell.sequence.store(position + 1, std::memory_order_release);
+                _tail.store(position + 1, std::memory_order_release);
+
+                const uint32_t depth = (position + 1) - _head.load(std::memory_order_relaxed);
+                if (depth > _highWaterMark.load(std::memory_order_relaxed)) {
+                    _highWaterMark.store(depth, std::memory_order_relaxed);
+                }
+                return true;
+            }
+
+            bool Pop(RECORD& record)
+            {
+                uint32_t position = _head.load(std::memory_order_relaxed);
+
+                while (true) {
+                    Cell& cell = _cells[position & Mask];
+                    const uint32_t sequence = cell.sequence.load(std::memory_order_acquire);
+                    const int32_t delta = static_cast<int32_t>(sequence - (position + 1));
+
+                    if (delta == 0) {
+                        if (_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                            record = cell.record;
+                            cell.sequence.store(position + CAPACITY, std::memory_order_release);
+                            return true;
+                        }
+                    } else if (delta < 0) {
+                        return false;
+                    } else {
+                        position = _head.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            bool IsEmpty() const
+            {
+                return (_head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire));
+            }
+            uint32_t Dropped() const
+            {
+                return _dropped.load(std::memory_order_relaxed);
+            }
+            uint32_t HighWaterMark() const
+            {
+                return _highWaterMark.load(std::memory_order_relaxed);
+            }
+            static constexpr uint32_t Capacity()
+            {
+                return CAPACITY;
+            }
+
+        private:
+            // Producer and consumer indexes live on separate cache lines so the HAL thread
+            // does not bounce the consumer's line on every push.
+            std::atomic<uint32_t> _head;
+            uint8_t _headPadding[CacheLine - sizeof(std::atomic<uint32_t>)];
+            std::atomic<uint32_t> _tail;
+            uint8_t _tailPadding[CacheLine - sizeof(std::atomic<uint32_t>)];
+            std::atomic<uint32_t> _dropped;
+            std::atomic<uint32_t> _highWaterMark;
+            Cell _cells[CAPACITY];
+        };
+
+    } // namespace Plugin
+} // namespace WPEFramework
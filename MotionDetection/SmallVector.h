@@ -0,0 +1,165 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2026 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+namespace WPEFramework {
+
+    namespace Plugin {
+
+        // Vector of plain-old-data elements with room for INLINE elements inside the object.
+        // Up to INLINE elements never touch the heap; beyond that the storage spills to a
+        // malloc'ed block that is kept (and reused) until the vector is destroyed.
+        template <typename ELEMENT, uint32_t INLINE>
+        class SmallVector {
+            static_assert(std::is_trivially_copyable<ELEMENT>::value, "ELEMENT must be trivially copyable");
+            static_assert(INLINE > 0, "INLINE must not be zero");
+
+        public:
+            SmallVector()
+                : _data(_inline)
+                , _size(0)
+                , _capacity(INLINE)
+            {
+            }
+            SmallVector(const SmallVector& copy)
+                : _data(_inline)
+                , _size(0)
+                , _capacity(INLINE)
+            {
+                Assign(copy.Data(), copy.Size());
+            }
+            SmallVector& operator=(const SmallVector& rhs)
+            {
+                if (this != &rhs) {
+                    Assign(rhs.Data(), rhs.Size());
+                }
+                return (*this);
+            }
+            ~SmallVector()
+            {
+                if (_data != _inline) {
+                    ::free(_data);
+                }
+            }
+
+        public:
+            void Assign(const ELEMENT* elements, const uint32_t count)
+            {
+                Reserve(count);
+                if (count > 0) {
+                    ::memcpy(_data, elements, count * sizeof(ELEMENT));
+                }
+                _size = count;
+            }
+            void PushBack(const ELEMENT& element)
+            {
+                if (_size == _capacity) {
+                    Reserve(_capacity * 2);
+                }
+                _data[_size++] = element;
+            }
+            void Resize(const uint32_t size)
+            {
+                Reserve(size);
+                _size = size;
+            }
+            void Clear()
+            {
+                _size = 0;
+            }
+            void Reserve(const uint32_t capacity)
+            {
+                if (capacity > _capacity) {
+                    void* storage = (_data == _inline) ? ::malloc(capacity * sizeof(ELEMENT)) : ::realloc(_data, capacity * sizeof(ELEMENT));
+                    if (storage == nullptr) {
+                        throw std::bad_alloc();
+                    }
+                    if (_data == _inline) {
+                        ::memcpy(storage, _inline, _size * sizeof(ELEMENT));
+                    }
+                    _data = static_cast<ELEMENT*>(storage);
+                    _capacity = capacity;
+                }
+            }
+
+            uint32_t Size() const
+            {
+                return _size;
+            }
+            bool IsEmpty() const
+            {
+                return (_size == 0);
+            }
+            bool IsInline() const
+            {
+                return (_data == _inline);
+            }
+            ELEMENT* Data()
+            {
+                return _data;
+            }
+            const ELEMENT* Data() const
+            {
+                return _data;
+            }
+            ELEMENT& operator[](const uint32_t index)
+            {
+                return _data[index];
+            }
+            const ELEMENT& operator[](const uint32_t index) const
+            {
+                return _data[index];
+            }
+            ELEMENT& Back()
+            {
+                return _data[_size - 1];
+            }
+            ELEMENT* begin()
+            {
+                return _data;
+            }
+            ELEMENT* end()
+            {
+                return _data + _size;
+            }
+            const ELEMENT* begin() const
+            {
+                return _data;
+            }
+            const ELEMENT* end() const
+            {
+                return _data + _size;
+            }
+
+        private:
+            ELEMENT* _data;
+            uint32_t _size;
+            uint32_t _capacity;
+            ELEMENT _inline[INLINE];
+        };
+
+    } // namespace Plugin
+} // namespace WPEFramework
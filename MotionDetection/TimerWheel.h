@@ -0,0 +1,156 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2026 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+
+#pragma once
+
+#include <cstdint>
+
+namespace WPEFramework {
+
+    namespace Plugin {
+
+        // Single threaded hashed timer wheel for a small, fixed set of timers (one per
+        // detector). Each slot holds a bitmask of the timers that expire in that tick, so
+        // scheduling and cancelling are O(1) and advancing only visits the ticks that passed.
+        // Timers further away than one revolution simply stay in their slot until their
+        // expiry is reached on a later pass. Times are in the caller's unit (nanoseconds).
+        template <uint32_t SLOTS, uint32_t TIMERS>
+        class TimerWheel {
+            static_assert((SLOTS >= 2) && ((SLOTS & (SLOTS - 1)) == 0), "SLOTS must be a power of two");
+            static_assert((TIMERS > 0) && (TIMERS <= 32), "TIMERS must fit in a 32 bit mask");
+
+        private:
+            static constexpr uint32_t Mask = SLOTS - 1;
+
+            TimerWheel(const TimerWheel&) = delete;
+            TimerWheel& operator=(const TimerWheel&) = delete;
+
+        public:
+            explicit TimerWheel(const uint64_t resolution)
+                : _resolution(resolution)
+                , _tick(0)
+                , _scheduled(0)
+            {
+                Reset(0);
+            }
+            ~TimerWheel() = default;
+
+        public:
+            void Reset(const uint64_t now)
+            {
+                _tick = now / _resolution;
+                _scheduled = 0;
+                for (uint32_t slot = 0; slot < SLOTS; slot++) {
+                    _slots[slot] = 0;
+                }
+            }
+
+            void Schedule(const uint32_t timer, const uint64_t expiry)
+            {
+                Cancel(timer);
+
+                uint64_t tick = expiry / _resolution;
+                if (tick < _tick) {
+                    tick = _tick;
+                }
+                _expiry[timer] = expiry;
+                _slot[timer] = static_cast<uint32_t>(tick & Mask);
+                _slots[_slot[timer]] |= (1U << timer);
+                _scheduled |= (1U << timer);
+            }
+
+            void Cancel(const uint32_t timer)
+            {
+                if ((_scheduled & (1U << timer)) != 0) {
+                    _slots[_slot[timer]] &= ~(1U << timer);
+                    _scheduled &= ~(1U << timer);
+                }
+            }
+
+            bool IsScheduled(const uint32_t timer) const
+            {
+                return ((_scheduled & (1U << timer)) != 0);
+            }
+
+            // Calls handler(timer) for every timer that expired at or before now. The handler
+            // may schedule timers again.
+            template <typename HANDLER>
+            void Advance(const uint64_t now, HANDLER& handler)
+            {
+                const uint64_t target = now / _resolution;
+                uint32_t expired = 0;
+
+                // A long gap visits every slot once, there is nothing more to find.
+                uint32_t visits = 0;
+                while (visits < SLOTS) {
+                    const uint32_t slot = static_cast<uint32_t>(_tick & Mask);
+                    uint32_t candidates = _slots[slot];
+                    while (candidates != 0) {
+                        const uint32_t timer = static_cast<uint32_t>(__builtin_ctz(candidates));
+                        candidates &= (candidates - 1);
+                        if (_expiry[timer] <= now) {
+                            _slots[slot] &= ~(1U << timer);
+                            _scheduled &= ~(1U << timer);
+                            expired |= (1U << timer);
+                        }
+                    }
+                    if (_tick >= target) {
+                        break;
+                    }
+                    _tick++;
+                    visits++;
+                }
+                if (_tick < target) {
+                    _tick = target;
+                }
+
+                while (expired != 0) {
+                    const uint32_t timer = static_cast<uint32_t>(__builtin_ctz(expired));
+                    expired &= (expired - 1);
+                    handler(timer);
+                }
+            }
+
+            // Earliest expiry of all scheduled timers, 0 if there is none.
+            uint64_t NextExpiry() const
+            {
+                uint64_t next = 0;
+                uint32_t scheduled = _scheduled;
+                while (scheduled != 0) {
+                    const uint32_t timer = static_cast<uint32_t>(__builtin_ctz(scheduled));
+                    scheduled &= (scheduled - 1);
+                    if ((next == 0) || (_expiry[timer] < next)) {
+                        next = _expiry[timer];
+                    }
+                }
+                return next;
+            }
+
+        private:
+            const uint64_t _resolution;
+            uint64_t _tick;
+            uint32_t _scheduled;
+            uint32_t _slots[SLOTS];
+            uint32_t _slot[TIMERS];
+            uint64_t _expiry[TIMERS];
+        };
+
+    } // namespace Plugin
+} // namespace WPEFramework
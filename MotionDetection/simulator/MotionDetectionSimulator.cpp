@@ -0,0 +1,591 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2026 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+
+// Simulated md-hal backend.
+// Implements the MOTION_DETECTION_* API in-process with a synthetic event generator so the
+// plugin can be load tested on a plain Linux box. The generator is configured through the
+// environment when MOTION_DETECTION_Platform_Init() is called:
+//
+//   MD_SIM_SENSORS            number of sensors, the first one is FP_MD (default 1)
+//   MD_SIM_MODE               "poisson", "burst" or "replay" (default poisson)
+//   MD_SIM_RATE               poisson: mean events per second per sensor (default 10)
+//   MD_SIM_BURST_SIZE         burst: events per sensor per burst (default 20)
+//   MD_SIM_BURST_INTERVAL_MS  burst: time between the start of two bursts (default 1000)
+//   MD_SIM_BURST_SPACING_US   burst: time between two events of a burst (default 0)
+//   MD_SIM_LATENCY_US         delay between generating an event and the callback (default 0)
+//   MD_SIM_JITTER_US          uniform random extra delay on top of the latency (default 0)
+//   MD_SIM_EVENT_TYPE         event type character reported to the callback (default '1')
+//   MD_SIM_MAX_EVENTS         stop generating after this many events, 0 is unlimited (default 0)
+//   MD_SIM_IGNORE_ARM         "1" generates events for disarmed sensors too (default 0)
+//   MD_SIM_SEED               random seed, for reproducible runs (default random)
+//   MD_SIM_REPLAY_FILE        replay: event log recorded with setEventRecording
+//   MD_SIM_REPLAY_SPEED       replay: 1 is real time, N is N times faster, 0 is as fast as
+//                             possible (default 1)
+//
+// In replay mode the sensors are the indexes found in the log (FP_MD is always present) and
+// the recorded events are sent with their original spacing, scaled by the replay speed.
+// MD_SIM_LATENCY_US, MD_SIM_JITTER_US, MD_SIM_MAX_EVENTS and MD_SIM_IGNORE_ARM still apply.
+//
+// Statistics on the generated events and the time spent in the callback are printed to
+// stderr by MOTION_DETECTION_Platform_Term().
+
+#include "motionDetector.h"
+#include "MotionEventLog.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    typedef std::chrono::steady_clock Clock;
+    typedef WPEFramework::Plugin::MotionEventLog::Entry ReplayEntry;
+
+    struct Sensor {
+        std::string index;
+        bool armed;
+        int mode;
+        unsigned int noMotionPeriod;
+        std::string sensitivity;
+        int sensitivityMode;
+    };
+
+    struct Configuration {
+        uint32_t sensors;
+        bool burst;
+        bool replay;
+        double replaySpeed;
+        double rate;
+        uint32_t burstSize;
+        uint32_t burstIntervalMs;
+        uint32_t burstSpacingUs;
+        uint32_t latencyUs;
+        uint32_t jitterUs;
+        char eventType;
+        uint64_t maxEvents;
+        bool ignoreArm;
+        uint32_t seed;
+    };
+
+    uint64_t EnvironmentNumber(const char name[], const uint64_t fallback)
+    {
+        const char* value = ::getenv(name);
+        return ((value != nullptr) && (*value != '\0') ? ::strtoull(value, nullptr, 10) : fallback);
+    }
+
+    class Simulator {
+    public:
+        Simulator()
+            : _callback(nullptr)
+            , _running(false)
+            , _generated(0)
+            , _delivered(0)
+            , _skipped(0)
+            , _callbackTotalNs(0)
+            , _callbackMaxNs(0)
+        {
+        }
+
+    public:
+        MOTION_DETECTION_Result_t Init()
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            if (_running) {
+                return MOTION_DETECTION_RESULT_SUCCESS;
+            }
+
+            const char* mode = ::getenv("MD_SIM_MODE");
+            const char* eventType = ::getenv("MD_SIM_EVENT_TYPE");
+
+            _config.sensors = std::max<uint64_t>(1, EnvironmentNumber("MD_SIM_SENSORS", 1));
+            _config.burst = ((mode != nullptr) && (::strcmp(mode, "burst") == 0));
+            _config.replay = ((mode != nullptr) && (::strcmp(mode, "replay") == 0));
+            _config.replaySpeed = (::getenv("MD_SIM_REPLAY_SPEED") != nullptr) ? ::atof(::getenv("MD_SIM_REPLAY_SPEED")) : 1.0;
+            _config.rate = (::getenv("MD_SIM_RATE") != nullptr) ? ::atof(::getenv("MD_SIM_RATE")) : 10.0;
+            _config.burstSize = std::max<uint64_t>(1, EnvironmentNumber("MD_SIM_BURST_SIZE", 20));
+            _config.burstIntervalMs = EnvironmentNumber("MD_SIM_BURST_INTERVAL_MS", 1000);
+            _config.burstSpacingUs = EnvironmentNumber("MD_SIM_BURST_SPACING_US", 0);
+            _config.latencyUs = EnvironmentNumber("MD_SIM_LATENCY_US", 0);
+            _config.jitterUs = EnvironmentNumber("MD_SIM_JITTER_US", 0);
+            _config.eventType = ((eventType != nullptr) && (*eventType != '\0')) ? eventType[0] : '1';
+            _config.maxEvents = EnvironmentNumber("MD_SIM_MAX_EVENTS", 0);
+            _config.ignoreArm = (EnvironmentNumber("MD_SIM_IGNORE_ARM", 0) != 0);
+            _config.seed = EnvironmentNumber("MD_SIM_SEED", std::random_device()());
+
+            if (_config.rate <= 0.0) {
+                _config.rate = 10.0;
+            }
+
+            if (_config.replaySpeed < 0.0) {
+                _config.replaySpeed = 1.0;
+            }
+
+            _sensors.clear();
+            _replay.clear();
+            if (_config.replay) {
+                if (!LoadReplay(::getenv("MD_SIM_REPLAY_FILE"))) {
+                    return MOTION_DETECTION_RESULT_INTI_FAILURE;
+                }
+                _config.sensors = _sensors.size();
+            } else {
+                for (uint32_t sensor = 0; sensor < _config.sensors; sensor++) {
+                    AddSensor((sensor == 0) ? std::string("FP_MD") : ("SIM_MD" + std::to_string(sensor)));
+                }
+            }
+            _activePeriod.clear();
+            _nowTime = 0;
+
+            _generated = 0;
+            _delivered = 0;
+            _skipped = 0;
+            _callbackTotalNs = 0;
+            _callbackMaxNs = 0;
+
+            _running = true;
+            _generator = std::thread(_config.replay ? &Simulator::Replay : &Simulator::Generate, this);
+
+            ::fprintf(stderr, "md-hal simulator: %u sensor(s), %s mode, latency %u+%uus\n",
+                _config.sensors, _config.replay ? "replay" : (_config.burst ? "burst" : "poisson"), _config.latencyUs, _config.jitterUs);
+            return MOTION_DETECTION_RESULT_SUCCESS;
+        }
+
+        MOTION_DETECTION_Result_t Term()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_lock);
+                if (!_running) {
+                    return MOTION_DETECTION_RESULT_SUCCESS;
+                }
+                _running = false;
+            }
+            _signal.notify_all();
+            _generator.join();
+
+            const uint64_t delivered = _delivered.load();
+            ::fprintf(stderr, "md-hal simulator: generated %llu, delivered %llu, skipped (disarmed) %llu, callback mean %lluns max %lluns\n",
+                static_cast<unsigned long long>(_generated.load()),
+                static_cast<unsigned long long>(delivered),
+                static_cast<unsigned long long>(_skipped.load()),
+                static_cast<unsigned long long>(delivered > 0 ? (_callbackTotalNs.load() / delivered) : 0),
+                static_cast<unsigned long long>(_callbackMaxNs.load()));
+            return MOTION_DETECTION_RESULT_SUCCESS;
+        }
+
+        MOTION_DETECTION_Result_t RegisterCallback(MOTION_DETECTION_OnMotionEventCallback callback)
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            _callback = callback;
+            return MOTION_DETECTION_RESULT_SUCCESS;
+        }
+
+        MOTION_DETECTION_Result_t Detectors(MOTION_DETECTION_CurrentSensorSettings_t* settings)
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            if ((settings == nullptr) || (_sensors.empty())) {
+                return MOTION_DETECTION_RESULT_INDEX_ERROR;
+            }
+
+            // The API reports a single detector.
+            ::memset(settings, 0, sizeof(*settings));
+            ::strncpy(settings->m_sensorIndex, _sensors[0].index.c_str(), sizeof(settings->m_sensorIndex) - 1);
+            ::strncpy(settings->m_sensorDescription, "Simulated motion detector", sizeof(settings->m_sensorDescription) - 1);
+            ::strncpy(settings->m_sensorType, "PIR", sizeof(settings->m_sensorType) - 1);
+            settings->m_sensorDistance = 6000;
+            settings->m_sensorAngle = 74;
+            settings->m_sensitivityMode = SENSITIVITY_MODE_LEVELS;
+            ::strncpy(settings->m_sensitivity[SENSITIVITY_IDENTIFIER_1], STR_SENSITIVITY_LOW, sizeof(settings->m_sensitivity[SENSITIVITY_IDENTIFIER_1]) - 1);
+            ::strncpy(settings->m_sensitivity[SENSITIVITY_IDENTIFIER_2], STR_SENSITIVITY_MEDIUM, sizeof(settings->m_sensitivity[SENSITIVITY_IDENTIFIER_2]) - 1);
+            ::strncpy(settings->m_sensitivity[SENSITIVITY_IDENTIFIER_3], STR_SENSITIVITY_HIGH, sizeof(settings->m_sensitivity[SENSITIVITY_IDENTIFIER_3]) - 1);
+            return MOTION_DETECTION_RESULT_SUCCESS;
+        }
+
+        MOTION_DETECTION_Result_t Arm(const std::string& index, const bool armed, const int mode)
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            Sensor* sensor = Find(index);
+            if (sensor == nullptr) {
+                return MOTION_DETECTION_RESULT_INDEX_ERROR;
+            }
+            sensor->armed = armed;
+            sensor->mode = mode;
+            return MOTION_DETECTION_RESULT_SUCCESS;
+        }
+
+        MOTION_DETECTION_Result_t IsArmed(const std::string& index, bool* armed)
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            Sensor* sensor = Find(index);
+            if ((sensor == nullptr) || (armed == nullptr)) {
+                return MOTION_DETECTION_RESULT_INDEX_ERROR;
+            }
+            *armed = sensor->armed;
+            return MOTION_DETECTION_RESULT_SUCCESS;
+        }
+
+        MOTION_DETECTION_Result_t SetNoMotionPeriod(const std::string& index, const unsigned int period)
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            Sensor* sensor = Find(index);
+            if (sensor == nullptr) {
+                return MOTION_DETECTION_RESULT_INDEX_ERROR;
+            }
+            sensor->noMotionPeriod = period;
+            return MOTION_DETECTION_RESULT_SUCCESS;
+        }
+
+        MOTION_DETECTION_Result_t GetNoMotionPeriod(const std::string& index, unsigned int* period)
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            Sensor* sensor = Find(index);
+            if ((sensor == nullptr) || (period == nullptr)) {
+                return MOTION_DETECTION_RESULT_INDEX_ERROR;
+            }
+            *period = sensor->noMotionPeriod;
+            return MOTION_DETECTION_RESULT_SUCCESS;
+        }
+
+        MOTION_DETECTION_Result_t SetSensitivity(const std::string& index, const std::string& sensitivity, const int mode)
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            Sensor* sensor = Find(index);
+            if (sensor == nullptr) {
+                return MOTION_DETECTION_RESULT_INDEX_ERROR;
+            }
+            sensor->sensitivity = sensitivity;
+            sensor->sensitivityMode = mode;
+            return MOTION_DETECTION_RESULT_SUCCESS;
+        }
+
+        MOTION_DETECTION_Result_t GetSensitivity(const std::string& index, char** sensitivity, int* mode)
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            Sensor* sensor = Find(index);
+            if ((sensor == nullptr) || (sensitivity == nullptr) || (mode == nullptr)) {
+                return MOTION_DETECTION_RESULT_INDEX_ERROR;
+            }
+            // Ownership passes to the caller, as with the real HAL.
+            *sensitivity = ::strdup(sensor->sensitivity.c_str());
+            *mode = sensor->sensitivityMode;
+            return MOTION_DETECTION_RESULT_SUCCESS;
+        }
+
+        MOTION_DETECTION_Result_t SetActivePeriod(const std::string& index, const MOTION_DETECTION_TimeRange_t& timeSet)
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            if ((Find(index) == nullptr) || ((timeSet.m_rangeCount > 0) && (timeSet.m_timeRangeArray == nullptr))) {
+                return MOTION_DETECTION_RESULT_INDEX_ERROR;
+            }
+            _nowTime = timeSet.m_nowTime;
+            _activePeriod.assign(timeSet.m_timeRangeArray, timeSet.m_timeRangeArray + timeSet.m_rangeCount);
+            return MOTION_DETECTION_RESULT_SUCCESS;
+        }
+
+        MOTION_DETECTION_Result_t GetActivePeriod(MOTION_DETECTION_TimeRange_t* timeSet)
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            if (timeSet == nullptr) {
+                return MOTION_DETECTION_RESULT_INDEX_ERROR;
+            }
+            // Points into simulator owned storage, valid until the next SetActivePeriod.
+            timeSet->m_nowTime = _nowTime;
+            timeSet->m_rangeCount = _activePeriod.size();
+            timeSet->m_timeRangeArray = _activePeriod.empty() ? nullptr : _activePeriod.data();
+            return MOTION_DETECTION_RESULT_SUCCESS;
+        }
+
+    private:
+        void AddSensor(const std::string& index)
+        {
+            Sensor entry;
+            entry.index = index;
+            entry.armed = false;
+            entry.mode = 0;
+            entry.noMotionPeriod = 0;
+            entry.sensitivity = STR_SENSITIVITY_MEDIUM;
+            entry.sensitivityMode = SENSITIVITY_MODE_LEVELS;
+            _sensors.push_back(entry);
+        }
+
+        // Reads the whole log up front, so file I/O does not disturb the replay timing.
+        bool LoadReplay(const char path[])
+        {
+            WPEFramework::Plugin::MotionEventLogReader reader;
+            if ((path == nullptr) || !reader.Open(path)) {
+                ::fprintf(stderr, "md-hal simulator: cannot read replay file '%s'\n", (path != nullptr) ? path : "");
+                return false;
+            }
+
+            AddSensor("FP_MD");
+            ReplayEntry entry;
+            while (reader.Read(entry)) {
+                if (Find(entry.index) == nullptr) {
+                    AddSensor(entry.index);
+                }
+                _replay.push_back(entry);
+            }
+            ::fprintf(stderr, "md-hal simulator: replaying %zu event(s) from '%s' at %gx\n", _replay.size(), path, _config.replaySpeed);
+            return true;
+        }
+
+        Sensor* Find(const std::string& index)
+        {
+            for (auto& sensor : _sensors) {
+                if (sensor.index == index) {
+                    return &sensor;
+                }
+            }
+            return nullptr;
+        }
+
+        // Generator thread: computes the due time of the next event, sleeps until then (or
+        // until Term), applies the configured delivery latency and calls the registered
+        // callback on this thread, just like the HAL event thread would.
+        void Generate()
+        {
+            std::mt19937 random(_config.seed);
+            std::exponential_distribution<double> interArrival(_config.rate * _config.sensors);
+            std::uniform_int_distribution<uint32_t> pickSensor(0, _config.sensors - 1);
+            std::uniform_int_distribution<uint32_t> jitter(0, _config.jitterUs);
+
+            Clock::time_point due = Clock::now();
+            uint32_t burstSensor = 0;
+            uint32_t burstEvent = 0;
+            Clock::time_point burstStart = due;
+
+            while (true) {
+                uint32_t sensor = 0;
+                if (_config.burst) {
+                    sensor = burstSensor;
+                    if (++burstEvent >= _config.burstSize) {
+                        burstEvent = 0;
+                        if (++burstSensor >= _config.sensors) {
+                            burstSensor = 0;
+                        }
+                    }
+                } else {
+                    sensor = pickSensor(random);
+                    due += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(interArrival(random)));
+                }
+
+                MOTION_DETECTION_OnMotionEventCallback callback = nullptr;
+                MOTION_DETECTION_EventMessage_t message;
+                bool deliver = false;
+                {
+                    std::unique_lock<std::mutex> lock(_lock);
+                    _signal.wait_until(lock, due, [this]() { return !_running; });
+                    if (!_running) {
+                        break;
+                    }
+
+                    const Sensor& source = _sensors[sensor];
+                    ::memset(&message, 0, sizeof(message));
+                    ::strncpy(message.m_sensorIndex, source.index.c_str(), sizeof(message.m_sensorIndex) - 1);
+                    message.m_eventType = static_cast<MOTION_DETECTION_Mode_t>(_config.eventType);
+                    callback = _callback;
+                    deliver = ((callback != nullptr) && (source.armed || _config.ignoreArm));
+                }
+
+                const uint64_t generated = ++_generated;
+
+                if (deliver) {
+                    Deliver(callback, message, _config.latencyUs + (_config.jitterUs > 0 ? jitter(random) : 0));
+                } else {
+                    _skipped++;
+                }
+
+                if ((_config.maxEvents > 0) && (generated >= _config.maxEvents)) {
+                    break;
+                }
+
+                if (_config.burst) {
+                    if ((burstEvent == 0) && (burstSensor == 0)) {
+                        burstStart += std::chrono::milliseconds(_config.burstIntervalMs);
+                        due = burstStart;
+                    } else {
+                        due += std::chrono::microseconds(_config.burstSpacingUs);
+                    }
+                }
+            }
+        }
+
+        // Replay thread: sends the recorded events with their recorded spacing divided by the
+        // replay speed, through the same delivery path as Generate().
+        void Replay()
+        {
+            std::mt19937 random(_config.seed);
+            std::uniform_int_distribution<uint32_t> jitter(0, _config.jitterUs);
+            const Clock::time_point start = Clock::now();
+
+            for (const ReplayEntry& entry : _replay) {
+                Clock::time_point due = start;
+                if (_config.replaySpeed > 0.0) {
+                    const double offset = static_cast<double>(entry.timestamp - _replay.front().timestamp) / _config.replaySpeed;
+                    due += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::nano>(offset));
+                }
+
+                MOTION_DETECTION_OnMotionEventCallback callback = nullptr;
+                MOTION_DETECTION_EventMessage_t message;
+                bool deliver = false;
+                {
+                    std::unique_lock<std::mutex> lock(_lock);
+                    _signal.wait_until(lock, due, [this]() { return !_running; });
+                    if (!_running) {
+                        break;
+                    }
+
+                    const Sensor* source = Find(entry.index);
+                    ::memset(&message, 0, sizeof(message));
+                    ::strncpy(message.m_sensorIndex, entry.index, sizeof(message.m_sensorIndex) - 1);
+                    message.m_eventType = static_cast<MOTION_DETECTION_Mode_t>(entry.eventType);
+                    callback = _callback;
+                    deliver = ((callback != nullptr) && (source != nullptr) && (source->armed || _config.ignoreArm));
+                }
+
+                const uint64_t generated = ++_generated;
+
+                if (deliver) {
+                    Deliver(callback, message, _config.latencyUs + (_config.jitterUs > 0 ? jitter(random) : 0));
+                } else {
+                    _skipped++;
+                }
+
+                if ((_config.maxEvents > 0) && (generated >= _config.maxEvents)) {
+                    break;
+                }
+            }
+        }
+
+        void Deliver(MOTION_DETECTION_OnMotionEventCallback callback, const MOTION_DETECTION_EventMessage_t& message, const uint32_t latency)
+        {
+            if (latency > 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(latency));
+            }
+
+            const Clock::time_point start = Clock::now();
+            callback(message);
+            const uint64_t duration = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+            _delivered++;
+            _callbackTotalNs += duration;
+            if (duration > _callbackMaxNs.load(std::memory_order_relaxed)) {
+                _callbackMaxNs.store(duration, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        std::mutex _lock;
+        std::condition_variable _signal;
+        Configuration _config;
+        std::vector<Sensor> _sensors;
+        std::vector<ReplayEntry> _replay;
+        std::vector<MOTION_DETECTION_Time_t> _activePeriod;
+        unsigned int _nowTime;
+        MOTION_DETECTION_OnMotionEventCallback _callback;
+        bool _running;
+        std::thread _generator;
+
+        std::atomic<uint64_t> _generated;
+        std::atomic<uint64_t> _delivered;
+        std::atomic<uint64_t> _skipped;
+        std::atomic<uint64_t> _callbackTotalNs;
+        std::atomic<uint64_t> _callbackMaxNs;
+    };
+
+    Simulator& Instance()
+    {
+        static Simulator simulator;
+        return simulator;
+    }
+
+} // namespace
+
+MOTION_DETECTION_Result_t MOTION_DETECTION_Platform_Init()
+{
+    return Instance().Init();
+}
+
+MOTION_DETECTION_Result_t MOTION_DETECTION_Platform_Term()
+{
+    return Instance().Term();
+}
+
+MOTION_DETECTION_Result_t MOTION_DETECTION_RegisterEventCallback(MOTION_DETECTION_OnMotionEventCallback motionEventCallback)
+{
+    return Instance().RegisterCallback(motionEventCallback);
+}
+
+MOTION_DETECTION_Result_t MOTION_DETECTION_GetMotionDetectors(MOTION_DETECTION_CurrentSensorSettings_t* motionDetectors)
+{
+    return Instance().Detectors(motionDetectors);
+}
+
+MOTION_DETECTION_Result_t MOTION_DETECTION_ArmMotionDetector(MOTION_DETECTION_Mode_t mode, std::string index)
+{
+    return Instance().Arm(index, true, static_cast<int>(mode));
+}
+
+MOTION_DETECTION_Result_t MOTION_DETECTION_DisarmMotionDetector(std::string index)
+{
+    return Instance().Arm(index, false, 0);
+}
+
+MOTION_DETECTION_Result_t MOTION_DETECTION_IsMotionDetectorArmed(std::string index, bool* armState)
+{
+    return Instance().IsArmed(index, armState);
+}
+
+MOTION_DETECTION_Result_t MOTION_DETECTION_SetNoMotionPeriod(std::string index, unsigned int period)
+{
+    return Instance().SetNoMotionPeriod(index, period);
+}
+
+MOTION_DETECTION_Result_t MOTION_DETECTION_GetNoMotionPeriod(std::string index, unsigned int* period)
+{
+    return Instance().GetNoMotionPeriod(index, period);
+}
+
+MOTION_DETECTION_Result_t MOTION_DETECTION_SetSensitivity(std::string index, std::string sensitivity, int inferredMode)
+{
+    return Instance().SetSensitivity(index, sensitivity, inferredMode);
+}
+
+MOTION_DETECTION_Result_t MOTION_DETECTION_GetSensitivity(std::string index, char** sensitivity, int* currentMode)
+{
+    return Instance().GetSensitivity(index, sensitivity, currentMode);
+}
+
+MOTION_DETECTION_Result_t MOTION_DETECTION_SetActivePeriod(std::string index, MOTION_DETECTION_TimeRange_t timeSet)
+{
+    return Instance().SetActivePeriod(index, timeSet);
+}
+
+MOTION_DETECTION_Result_t MOTION_DETECTION_GetActivePeriod(MOTION_DETECTION_TimeRange_t* timeSet)
+{
+    return Instance().GetActivePeriod(timeSet);
+}
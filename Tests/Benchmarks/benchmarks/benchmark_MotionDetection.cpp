@@ -0,0 +1,397 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2026 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#include <benchmark/benchmark.h>
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "MotionDetection.h"
+#include "FactoriesImplementation.h"
+#include "MotionDetectionMock.h"
+
+#include "ServiceMock.h"
+#include "ThunderPortability.h"
+
+using namespace WPEFramework;
+
+using ::testing::NiceMock;
+
+// Every heap allocation made by the process is counted, so a benchmark can report the
+// allocations of the code under test per operation.
+namespace {
+    std::atomic<uint64_t> allocations(0);
+}
+
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* memory = std::malloc(size != 0 ? size : 1);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+namespace {
+
+    struct Request {
+        const TCHAR* method;
+        const TCHAR* parameters;
+    };
+
+    // One entry per registered JSON-RPC method, with parameters that succeed against the mock HAL.
+    const Request requests[] = {
+        { _T("getMotionDetectors"), _T("{}") },
+        { _T("arm"), _T("{\"index\":\"FP_MD\",\"mode\":\"1\"}") },
+        { _T("disarm"), _T("{\"index\":\"FP_MD\"}") },
+        { _T("isarmed"), _T("{\"index\":\"FP_MD\"}") },
+        { _T("setNoMotionPeriod"), _T("{\"index\":\"FP_MD\",\"period\":\"10\"}") },
+        { _T("getNoMotionPeriod"), _T("{\"index\":\"FP_MD\"}") },
+        { _T("setSensitivity"), _T("{\"index\":\"FP_MD\",\"name\":\"high\"}") },
+        { _T("getSensitivity"), _T("{\"index\":\"FP_MD\"}") },
+        { _T("getLastMotionEventElapsedTime"), _T("{}") },
+        { _T("setMotionEventsActivePeriod"), _T("{\"index\":\"FP_MD\",\"nowTime\":1023,\"ranges\":[{\"startTime\":\"100\",\"endTime\":\"150\"},{\"startTime\":\"80000\",\"endTime\":\"50\"}]}") },
+        { _T("getMotionEventsActivePeriod"), _T("{}") },
+        { _T("getMotionEventHistory"), _T("{\"index\":\"FP_MD\",\"limit\":16}") },
+        { _T("setEventCoalescing"), _T("{\"index\":\"FP_MD\",\"window\":0}") },
+        { _T("refresh"), _T("{\"index\":\"FP_MD\"}") },
+        { _T("configureDetectors"), _T("{\"detectors\":[{\"index\":\"FP_MD\",\"mode\":\"1\",\"period\":\"10\",\"name\":\"high\"}]}") },
+        { _T("isMotionEventsActive"), _T("{\"time\":120}") },
+        { _T("getPresence"), _T("{\"index\":\"FP_MD\"}") },
+        { _T("setEventFilter"), _T("{\"id\":\"client.events.1\",\"indexes\":[\"FP_MD\"],\"eventTypes\":[\"1\"]}") },
+        { _T("setEventEncoding"), _T("{\"id\":\"client.events.1\",\"encoding\":\"json\"}") },
+        { _T("getPerformanceMetrics"), _T("{}") },
+        { _T("resetPerformanceMetrics"), _T("{}") },
+        { _T("setEventRecording"), _T("{\"enable\":false}") },
+        { _T("setArmSchedule"), _T("{\"index\":\"FP_MD\",\"mode\":\"1\",\"ranges\":[{\"startTime\":\"79200\",\"endTime\":\"25200\"}]}") },
+        { _T("getArmSchedule"), _T("{\"index\":\"FP_MD\"}") },
+    };
+
+    constexpr uint32_t EventBatch = 64;
+
+}
+
+class MotionDetectionBenchmark : public benchmark::Fixture {
+protected:
+    Core::ProxyType<Plugin::MotionDetection> plugin;
+    Core::JSONRPC::Handler* jsonrpc = nullptr;
+    DECL_CORE_JSONRPC_CONX connection;
+    string response;
+
+    NiceMock<ServiceMock> service;
+    NiceMock<FactoriesImplementation> factoriesImplementation;
+    Core::JSONRPC::Message message;
+    PLUGINHOST_DISPATCHER* dispatcher = nullptr;
+    // Set by benchmarks that deinitialize the plugin themselves.
+    bool deinitialized = false;
+
+    NiceMock<MotionDetectionImplMock>* p_motionDetectionImplMock = nullptr;
+    MOTION_DETECTION_Result_t (*halEventCallback)(MOTION_DETECTION_EventMessage_t) = nullptr;
+
+    std::mutex notifyLock;
+    std::condition_variable notified;
+    uint64_t notifications = 0;
+
+    MotionDetectionBenchmark()
+        : INIT_CONX(1, 0)
+    {
+    }
+
+    void SetUp(const ::benchmark::State&) override
+    {
+        p_motionDetectionImplMock = new NiceMock<MotionDetectionImplMock>;
+        MotionDetection::setImpl(p_motionDetectionImplMock);
+
+        ON_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_RegisterEventCallback(::testing::_))
+            .WillByDefault(::testing::Invoke(
+                [&](MOTION_DETECTION_Result_t (*callback)(MOTION_DETECTION_EventMessage_t)) {
+                    halEventCallback = callback;
+                    return MOTION_DETECTION_RESULT_SUCCESS;
+                }));
+        ON_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_GetMotionDetectors(::testing::_))
+            .WillByDefault(::testing::Invoke(
+                [](MOTION_DETECTION_CurrentSensorSettings_t* pSensorStatus) {
+                    memset(pSensorStatus, 0, sizeof(MOTION_DETECTION_CurrentSensorSettings_t));
+                    strncpy(pSensorStatus->m_sensorIndex, "FP_MD", sizeof(pSensorStatus->m_sensorIndex) - 1);
+                    pSensorStatus->m_sensitivityMode = 2;
+                    strncpy(pSensorStatus->m_sensitivity[SENSITIVITY_IDENTIFIER_1], STR_SENSITIVITY_LOW, sizeof(pSensorStatus->m_sensitivity[SENSITIVITY_IDENTIFIER_1]) - 1);
+                    strncpy(pSensorStatus->m_sensitivity[SENSITIVITY_IDENTIFIER_2], STR_SENSITIVITY_MEDIUM, sizeof(pSensorStatus->m_sensitivity[SENSITIVITY_IDENTIFIER_2]) - 1);
+                    strncpy(pSensorStatus->m_sensitivity[SENSITIVITY_IDENTIFIER_3], STR_SENSITIVITY_HIGH, sizeof(pSensorStatus->m_sensitivity[SENSITIVITY_IDENTIFIER_3]) - 1);
+                    return MOTION_DETECTION_RESULT_SUCCESS;
+                }));
+        ON_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_GetSensitivity(::testing::_, ::testing::_, ::testing::_))
+            .WillByDefault(::testing::Invoke(
+                [](std::string index, char** sensitivity, int* currentMode) {
+                    *currentMode = 2;
+                    *sensitivity = strdup(STR_SENSITIVITY_HIGH);
+                    return MOTION_DETECTION_RESULT_SUCCESS;
+                }));
+        ON_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_GetActivePeriod(::testing::_))
+            .WillByDefault(::testing::Invoke(
+                [](MOTION_DETECTION_TimeRange_t* timeSet) {
+                    timeSet->m_rangeCount = 0;
+                    timeSet->m_timeRangeArray = nullptr;
+                    return MOTION_DETECTION_RESULT_SUCCESS;
+                }));
+
+        ON_CALL(service, Submit(::testing::_, ::testing::_))
+            .WillByDefault(::testing::Invoke(
+                [&](const uint32_t, const Core::ProxyType<Core::JSON::IElement>&) {
+                    std::lock_guard<std::mutex> lock(notifyLock);
+                    notifications++;
+                    notified.notify_all();
+                    return Core::ERROR_NONE;
+                }));
+
+        PluginHost::IFactories::Assign(&factoriesImplementation);
+
+        plugin = Core::ProxyType<Plugin::MotionDetection>::Create();
+        jsonrpc = &(*plugin);
+        dispatcher = static_cast<PLUGINHOST_DISPATCHER*>(plugin->QueryInterface(PLUGINHOST_DISPATCHER_ID));
+        dispatcher->Activate(&service);
+
+        plugin->Initialize(nullptr);
+        deinitialized = false;
+        notifications = 0;
+    }
+
+    void TearDown(const ::benchmark::State&) override
+    {
+        if (!deinitialized) {
+            plugin->Deinitialize(nullptr);
+        }
+
+        dispatcher->Deactivate();
+        dispatcher->Release();
+        plugin.Release();
+        jsonrpc = nullptr;
+
+        PluginHost::IFactories::Assign(nullptr);
+        MotionDetection::setImpl(nullptr);
+        delete p_motionDetectionImplMock;
+        p_motionDetectionImplMock = nullptr;
+        halEventCallback = nullptr;
+    }
+
+    static MOTION_DETECTION_EventMessage_t Event()
+    {
+        MOTION_DETECTION_EventMessage_t eventMsg;
+        memset(&eventMsg, 0, sizeof(eventMsg));
+        strncpy(eventMsg.m_sensorIndex, "FP_MD", sizeof(eventMsg.m_sensorIndex) - 1);
+        eventMsg.m_eventType = static_cast<decltype(eventMsg.m_eventType)>('1');
+        return eventMsg;
+    }
+
+    bool WaitForNotifications(const uint64_t count)
+    {
+        std::unique_lock<std::mutex> lock(notifyLock);
+        return notified.wait_for(lock, std::chrono::seconds(5), [&]() { return (notifications >= count); });
+    }
+};
+
+// Cost of one JSON-RPC request through Core::JSONRPC::Handler::Invoke, per registered method.
+// Getters are measured in their steady state, i.e. after the first call filled the cache.
+BENCHMARK_DEFINE_F(MotionDetectionBenchmark, Invoke)(benchmark::State& state)
+{
+    Core::JSONRPC::Handler& handler = *jsonrpc;
+    const Request& request = requests[state.range(0)];
+    state.SetLabel(request.method);
+
+    // A method that was renamed or does not succeed would only measure the error path.
+    if (handler.Invoke(connection, request.method, request.parameters, response) != Core::ERROR_NONE) {
+        state.SkipWithError("Request failed");
+        return;
+    }
+
+    const uint64_t before = allocations.load(std::memory_order_relaxed);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(handler.Invoke(connection, request.method, request.parameters, response));
+    }
+    state.counters["allocs/op"] = benchmark::Counter(static_cast<double>(allocations.load(std::memory_order_relaxed) - before), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK_REGISTER_F(MotionDetectionBenchmark, Invoke)->DenseRange(0, (sizeof(requests) / sizeof(requests[0])) - 1);
+
+// Producer side of the event path: the time the md-hal thread spends in the plugin callback.
+// The queue is drained (untimed) after every EventBatch events, so no event is dropped and only
+// the queuing path is measured.
+BENCHMARK_DEFINE_F(MotionDetectionBenchmark, EventCallback)(benchmark::State& state)
+{
+    Core::JSONRPC::Handler& handler = *jsonrpc;
+    const MOTION_DETECTION_EventMessage_t eventMsg = Event();
+
+    EVENT_SUBSCRIBE(0, _T("onMotionEvent"), _T("org.rdk.MotionDetection"), message);
+
+    uint64_t expected = 0;
+    const uint64_t before = allocations.load(std::memory_order_relaxed);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(halEventCallback(eventMsg));
+        if ((++expected % EventBatch) == 0) {
+            state.PauseTiming();
+            bool drained = WaitForNotifications(expected);
+            state.ResumeTiming();
+            if (!drained) {
+                state.SkipWithError("Timed out waiting for notifications");
+                break;
+            }
+        }
+    }
+    state.counters["allocs/op"] = benchmark::Counter(static_cast<double>(allocations.load(std::memory_order_relaxed) - before), benchmark::Counter::kAvgIterations);
+
+    // Let the last events drain before the client goes away.
+    WaitForNotifications(expected);
+    EVENT_UNSUBSCRIBE(0, _T("onMotionEvent"), _T("org.rdk.MotionDetection"), message);
+}
+BENCHMARK_REGISTER_F(MotionDetectionBenchmark, EventCallback);
+
+// End to end: a batch of events pushed through the HAL callback until every subscriber was
+// notified of each of them. The argument is the number of subscribed clients.
+BENCHMARK_DEFINE_F(MotionDetectionBenchmark, EventFanOut)(benchmark::State& state)
+{
+    Core::JSONRPC::Handler& handler = *jsonrpc;
+    const uint32_t subscribers = static_cast<uint32_t>(state.range(0));
+    const MOTION_DETECTION_EventMessage_t eventMsg = Event();
+
+    for (uint32_t subscriber = 0; subscriber < subscribers; subscriber++) {
+        EVENT_SUBSCRIBE(subscriber, _T("onMotionEvent"), _T("org.rdk.MotionDetection"), message);
+    }
+
+    uint64_t expected = 0;
+    const uint64_t before = allocations.load(std::memory_order_relaxed);
+    for (auto _ : state) {
+        for (uint32_t event = 0; event < EventBatch; event++) {
+            halEventCallback(eventMsg);
+        }
+        expected += static_cast<uint64_t>(EventBatch) * subscribers;
+        if (!WaitForNotifications(expected)) {
+            state.SkipWithError("Timed out waiting for notifications");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * EventBatch);
+    state.counters["allocs/event"] = benchmark::Counter(static_cast<double>(allocations.load(std::memory_order_relaxed) - before) / EventBatch, benchmark::Counter::kAvgIterations);
+
+    for (uint32_t subscriber = 0; subscriber < subscribers; subscriber++) {
+        EVENT_UNSUBSCRIBE(subscriber, _T("onMotionEvent"), _T("org.rdk.MotionDetection"), message);
+    }
+}
+BENCHMARK_REGISTER_F(MotionDetectionBenchmark, EventFanOut)->Arg(1)->Arg(4)->Arg(16)->UseRealTime();
+
+// Dispatch of a recorded event stream (setEventRecording) replayed as fast as possible through
+// the HAL callback to one subscriber. The log is taken from MD_BENCHMARK_EVENT_LOG.
+BENCHMARK_DEFINE_F(MotionDetectionBenchmark, EventReplay)(benchmark::State& state)
+{
+    Core::JSONRPC::Handler& handler = *jsonrpc;
+    const char* path = ::getenv("MD_BENCHMARK_EVENT_LOG");
+    std::vector<MOTION_DETECTION_EventMessage_t> events;
+
+    Plugin::MotionEventLogReader reader;
+    if ((path == nullptr) || !reader.Open(path)) {
+        state.SkipWithError("MD_BENCHMARK_EVENT_LOG does not name a readable event log");
+        return;
+    }
+    Plugin::MotionEventLog::Entry entry;
+    while (reader.Read(entry)) {
+        MOTION_DETECTION_EventMessage_t eventMsg;
+        memset(&eventMsg, 0, sizeof(eventMsg));
+        strncpy(eventMsg.m_sensorIndex, entry.index, sizeof(eventMsg.m_sensorIndex) - 1);
+        eventMsg.m_eventType = static_cast<decltype(eventMsg.m_eventType)>(entry.eventType);
+        events.push_back(eventMsg);
+    }
+
+    EVENT_SUBSCRIBE(0, _T("onMotionEvent"), _T("org.rdk.MotionDetection"), message);
+
+    // Sent in batches smaller than the event queue, a dropped event would never be notified.
+    uint64_t expected = 0;
+    bool timedOut = false;
+    for (auto _ : state) {
+        for (size_t event = 0; (event < events.size()) && !timedOut; event++) {
+            halEventCallback(events[event]);
+            expected++;
+            if ((expected % EventBatch) == 0) {
+                timedOut = !WaitForNotifications(expected);
+            }
+        }
+        if (timedOut || !WaitForNotifications(expected)) {
+            state.SkipWithError("Timed out waiting for notifications");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * events.size());
+
+    EVENT_UNSUBSCRIBE(0, _T("onMotionEvent"), _T("org.rdk.MotionDetection"), message);
+}
+BENCHMARK_REGISTER_F(MotionDetectionBenchmark, EventReplay)->UseRealTime();
+
+// Deinitialize while the md-hal thread keeps calling back, i.e. the time to retire the
+// instance and drain the callbacks in flight. Callbacks made while the plugin is down are
+// ignored and counted.
+BENCHMARK_DEFINE_F(MotionDetectionBenchmark, DeinitializeUnderLoad)(benchmark::State& state)
+{
+    const MOTION_DETECTION_EventMessage_t eventMsg = Event();
+    MOTION_DETECTION_Result_t (*callback)(MOTION_DETECTION_EventMessage_t) = halEventCallback;
+    std::atomic<bool> running(true);
+    std::atomic<uint64_t> ignored(0);
+
+    std::thread hal([&]() {
+        while (running.load(std::memory_order_relaxed)) {
+            if (callback(eventMsg) != MOTION_DETECTION_RESULT_SUCCESS) {
+                ignored.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    });
+
+    // Deinitialize unregisters the methods, so the fixture's instance is retired once and
+    // every iteration times a fresh one; creating and releasing them is not timed.
+    plugin->Deinitialize(nullptr);
+    deinitialized = true;
+    Core::ProxyType<Plugin::MotionDetection> instance;
+    for (auto _ : state) {
+        state.PauseTiming();
+        instance = Core::ProxyType<Plugin::MotionDetection>::Create();
+        instance->Initialize(nullptr);
+        state.ResumeTiming();
+        instance->Deinitialize(nullptr);
+    }
+
+    running.store(false, std::memory_order_relaxed);
+    hal.join();
+    instance.Release();
+    state.counters["ignored"] = benchmark::Counter(static_cast<double>(ignored.load(std::memory_order_relaxed)), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK_REGISTER_F(MotionDetectionBenchmark, DeinitializeUnderLoad)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -18,7 +18,14 @@
 **/
 
 #include <gtest/gtest.h>
+#include <cstdio>
 #include <iostream>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <vector>
 
 #include "MotionDetection.h"
 #include "FactoriesImplementation.h"
@@ -26,6 +33,7 @@
 
 #include "IarmBusMock.h"
 #include "ServiceMock.h"
+#include "TelemetryMock.h"
 #include "ThunderPortability.h"
 
 using namespace WPEFramework;
@@ -52,6 +60,19 @@ class MotionDetectionEventTest : public MotionDetectionTest {
 protected:
 
     MotionDetectionImplMock   *p_motionDetectionImplMock = nullptr ;
+    MOTION_DETECTION_Result_t (*halEventCallback)(MOTION_DETECTION_EventMessage_t) = nullptr;
+
+    NiceMock<ServiceMock> service;
+    NiceMock<FactoriesImplementation> factoriesImplementation;
+    Core::JSONRPC::Message message;
+    PLUGINHOST_DISPATCHER* dispatcher = nullptr;
+    // Set by tests that deinitialize the plugin themselves.
+    bool deinitialized = false;
+
+    // Every notification sent to a subscribed client, in the order they were submitted.
+    std::mutex notifyLock;
+    std::condition_variable notified;
+    std::vector<string> notifications;
 
     MotionDetectionEventTest()
         : MotionDetectionTest()
@@ -64,18 +85,62 @@ protected:
               .WillByDefault(::testing::Return(MOTION_DETECTION_RESULT_SUCCESS));
 
           ON_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_RegisterEventCallback(::testing::_))
-              .WillByDefault(::testing::Return(MOTION_DETECTION_RESULT_SUCCESS));
+              .WillByDefault(::testing::Invoke(
+                  [&](auto callback) {
+                      halEventCallback = callback;
+                      return MOTION_DETECTION_RESULT_SUCCESS;
+                  }));
 
           ON_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_DisarmMotionDetector(::testing::_))
               .WillByDefault(::testing::Return(MOTION_DETECTION_RESULT_SUCCESS));
 
+          // Capabilities are read once during Initialize.
+          ON_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_GetMotionDetectors(::testing::_))
+              .WillByDefault(::testing::Invoke(
+                  [](MOTION_DETECTION_CurrentSensorSettings_t *pSensorStatus) {
+                      memset(pSensorStatus, 0, sizeof(MOTION_DETECTION_CurrentSensorSettings_t));
+
+                      strncpy(pSensorStatus->m_sensorIndex, MOTION_DETECTOR, sizeof(pSensorStatus->m_sensorIndex) - 1);
+                      strncpy(pSensorStatus->m_sensorDescription, MOTION_DETECTION_DESCRIPTION, sizeof(pSensorStatus->m_sensorDescription) - 1);
+                      strncpy(pSensorStatus->m_sensorType, MOTION_DETECTOR_TYPE, sizeof(pSensorStatus->m_sensorType) - 1);
+                      pSensorStatus->m_sensorDistance = MOTION_DETECTION_DISTANCE;
+                      pSensorStatus->m_sensorAngle = MOTION_DETECTION_ANGLE;
+                      pSensorStatus->m_sensitivityMode = 2;
+
+                      strncpy(pSensorStatus->m_sensitivity[SENSITIVITY_IDENTIFIER_1], STR_SENSITIVITY_LOW, sizeof(pSensorStatus->m_sensitivity[SENSITIVITY_IDENTIFIER_1]) - 1);
+                      strncpy(pSensorStatus->m_sensitivity[SENSITIVITY_IDENTIFIER_2], STR_SENSITIVITY_MEDIUM, sizeof(pSensorStatus->m_sensitivity[SENSITIVITY_IDENTIFIER_2]) - 1);
+                      strncpy(pSensorStatus->m_sensitivity[SENSITIVITY_IDENTIFIER_3], STR_SENSITIVITY_HIGH, sizeof(pSensorStatus->m_sensitivity[SENSITIVITY_IDENTIFIER_3]) - 1);
+
+                      return MOTION_DETECTION_RESULT_SUCCESS;
+                  }));
+
+          ON_CALL(service, Submit(::testing::_, ::testing::_))
+              .WillByDefault(::testing::Invoke(
+                  [&](const uint32_t, const Core::ProxyType<Core::JSON::IElement>& json) {
+                      string text;
+                      json->ToString(text);
+                      std::lock_guard<std::mutex> lock(notifyLock);
+                      notifications.push_back(text);
+                      notified.notify_all();
+                      return Core::ERROR_NONE;
+                  }));
+
+          PluginHost::IFactories::Assign(&factoriesImplementation);
+          dispatcher = static_cast<PLUGINHOST_DISPATCHER*>(plugin->QueryInterface(PLUGINHOST_DISPATCHER_ID));
+          dispatcher->Activate(&service);
+
            EXPECT_EQ(string(""), plugin->Initialize(nullptr));
 
     }
     virtual ~MotionDetectionEventTest() override
     {
 
-        plugin->Deinitialize(nullptr);
+        if (!deinitialized) {
+            plugin->Deinitialize(nullptr);
+        }
+        dispatcher->Deactivate();
+        dispatcher->Release();
+        PluginHost::IFactories::Assign(nullptr);
         MotionDetection::setImpl(nullptr);
         if (p_motionDetectionImplMock != nullptr)
         {
@@ -83,6 +148,37 @@ protected:
             p_motionDetectionImplMock = nullptr;
         }
     }
+
+    static MOTION_DETECTION_EventMessage_t Event(const char* index, const char eventType)
+    {
+        MOTION_DETECTION_EventMessage_t eventMsg;
+        memset(&eventMsg, 0, sizeof(eventMsg));
+        strncpy(eventMsg.m_sensorIndex, index, sizeof(eventMsg.m_sensorIndex) - 1);
+        eventMsg.m_eventType = static_cast<decltype(eventMsg.m_eventType)>(eventType);
+        return eventMsg;
+    }
+
+    // Notifications are sent from the dispatcher thread, waits up to 5 seconds for them.
+    bool WaitForNotifications(const size_t count)
+    {
+        std::unique_lock<std::mutex> lock(notifyLock);
+        return notified.wait_for(lock, std::chrono::seconds(5), [&]() { return (notifications.size() >= count); });
+    }
+
+    string Notification(const size_t position)
+    {
+        std::lock_guard<std::mutex> lock(notifyLock);
+        return (position < notifications.size()) ? notifications[position] : string();
+    }
+
+    static JsonObject Params(const string& notification)
+    {
+        Core::JSONRPC::Message jsonrpc;
+        jsonrpc.FromString(notification);
+        JsonObject params;
+        params.FromString(jsonrpc.Parameters.Value());
+        return params;
+    }
 };
 
 TEST_F(MotionDetectionTest, RegisteredMethods)
@@ -97,33 +193,50 @@ TEST_F(MotionDetectionTest, RegisteredMethods)
     EXPECT_EQ(Core::ERROR_NONE, handler.Exists(_T("getSensitivity")));
     EXPECT_EQ(Core::ERROR_NONE, handler.Exists(_T("getLastMotionEventElapsedTime")));
     EXPECT_EQ(Core::ERROR_NONE, handler.Exists(_T("setMotionEventsActivePeriod")));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Exists(_T("getMotionEventHistory")));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Exists(_T("setEventCoalescing")));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Exists(_T("refresh")));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Exists(_T("configureDetectors")));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Exists(_T("isMotionEventsActive")));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Exists(_T("getPresence")));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Exists(_T("setEventFilter")));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Exists(_T("setEventEncoding")));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Exists(_T("getPerformanceMetrics")));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Exists(_T("resetPerformanceMetrics")));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Exists(_T("setEventRecording")));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Exists(_T("setArmSchedule")));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Exists(_T("getArmSchedule")));
 }
 
 TEST_F(MotionDetectionEventTest, getMotionDetectors)
 {
-                EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_GetMotionDetectors(::testing::_))
-                        .Times(1)
-                        .WillOnce(::testing::Invoke(   
-                                [](MOTION_DETECTION_CurrentSensorSettings_t *pSensorStatus) {
+        // Served from the capability table built in Initialize, no HAL round trip.
+        EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_GetMotionDetectors(::testing::_))
+                .Times(0);
 
-                memset(pSensorStatus, 0, sizeof(MOTION_DETECTION_CurrentSensorSettings_t));
+        for (int request = 0; request < 2; request++) {
+                EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("getMotionDetectors"), _T("{}"), response));
+                EXPECT_EQ(response,  string("{\"supportedMotionDetectors\":[\"FP_MD\"],\"supportedMotionDetectorsInfo\":{\"FP_MD\":{\"description\":\"The only motion detector\",\"type\":\"PID\",\"distance\":\"6000\",\"angle\":\"74\",\"sensitivityMode\":\"2\",\"sensitivities\":[\"low\",\"medium\",\"high\"]}},\"success\":true}"));
+        }
+}
 
-                strncpy(pSensorStatus->m_sensorIndex, MOTION_DETECTOR, sizeof(pSensorStatus->m_sensorIndex) - 1);
-                strncpy(pSensorStatus->m_sensorDescription, MOTION_DETECTION_DESCRIPTION, sizeof(pSensorStatus->m_sensorDescription) - 1);
-                strncpy(pSensorStatus->m_sensorType, MOTION_DETECTOR_TYPE, sizeof(pSensorStatus->m_sensorType) - 1);
-                pSensorStatus->m_sensorDistance = MOTION_DETECTION_DISTANCE;
-                pSensorStatus->m_sensorAngle = MOTION_DETECTION_ANGLE;
-                pSensorStatus->m_sensitivityMode = 2;
+TEST_F(MotionDetectionEventTest, getMotionDetectorsReloadsOnUnknownDetector)
+{
+        ASSERT_NE(nullptr, halEventCallback);
+        EVENT_SUBSCRIBE(0, _T("onMotionEvent"), _T("client.events"), message);
 
-                strncpy(pSensorStatus->m_sensitivity[SENSITIVITY_IDENTIFIER_1], STR_SENSITIVITY_LOW, sizeof(pSensorStatus->m_sensitivity[SENSITIVITY_IDENTIFIER_1]) - 1);
-                strncpy(pSensorStatus->m_sensitivity[SENSITIVITY_IDENTIFIER_2], STR_SENSITIVITY_MEDIUM, sizeof(pSensorStatus->m_sensitivity[SENSITIVITY_IDENTIFIER_2]) - 1);
-                strncpy(pSensorStatus->m_sensitivity[SENSITIVITY_IDENTIFIER_3], STR_SENSITIVITY_HIGH, sizeof(pSensorStatus->m_sensitivity[SENSITIVITY_IDENTIFIER_3]) - 1);
+        // Initialize already read the capabilities, only the unknown detector reloads them.
+        EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_GetMotionDetectors(::testing::_))
+                .Times(1);
 
-                return MOTION_DETECTION_RESULT_SUCCESS;
-            }));
+        EXPECT_EQ(MOTION_DETECTION_RESULT_SUCCESS, halEventCallback(Event("MD_2", '1')));
 
+        // The capabilities are marked stale before the event is notified.
+        ASSERT_TRUE(WaitForNotifications(1));
         EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("getMotionDetectors"), _T("{}"), response));
-        EXPECT_EQ(response,  string("{\"supportedMotionDetectors\":[\"FP_MD\"],\"supportedMotionDetectorsInfo\":{\"FP_MD\":{\"description\":\"The only motion detector\",\"type\":\"PID\",\"distance\":\"6000\",\"angle\":\"74\",\"sensitivityMode\":\"2\",\"sensitivities\":[\"low\",\"medium\",\"high\"]}},\"success\":true}"));
+        EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("getMotionDetectors"), _T("{}"), response));
+
+        EVENT_UNSUBSCRIBE(0, _T("onMotionEvent"), _T("client.events"), message);
 }
 
 TEST_F(MotionDetectionEventTest, armmotiondetected)
@@ -190,10 +303,27 @@ TEST_F(MotionDetectionEventTest, isarmed)
             }));
 
 
-    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("isarmed"), _T("{\"index\"=\"FP_MD\"}"), response));
+    // FP_MD was disarmed by Initialize, so its state is known. Another index goes to the HAL.
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("isarmed"), _T("{\"index\":\"MD_2\"}"), response));
     EXPECT_EQ(response,  string("{\"state\":false,\"success\":true}"));
 }
 
+TEST_F(MotionDetectionEventTest, isarmedCached)
+{
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_IsMotionDetectorArmed(::testing::_,::testing::_))
+    .Times(0);
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_ArmMotionDetector(::testing::_,::testing::_))
+    .Times(1)
+    .WillOnce(::testing::Return(MOTION_DETECTION_RESULT_SUCCESS));
+
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("isarmed"), _T("{\"index\":\"FP_MD\"}"), response));
+    EXPECT_EQ(response,  string("{\"state\":false,\"success\":true}"));
+
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("arm"), _T("{\"index\":\"FP_MD\",\"mode\":\"1\" }"), response));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("isarmed"), _T("{\"index\":\"FP_MD\"}"), response));
+    EXPECT_EQ(response,  string("{\"state\":true,\"success\":true}"));
+}
+
 TEST_F(MotionDetectionEventTest, isarmedInvalid)
 {
     EXPECT_CALL(*p_motionDetectionImplMock,MOTION_DETECTION_IsMotionDetectorArmed(::testing::_,::testing::_))
@@ -204,7 +334,7 @@ TEST_F(MotionDetectionEventTest, isarmedInvalid)
             }));
 
 
-    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("isarmed"), _T("{\"index\"=\"FP_MD\"}"), response));
+    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("isarmed"), _T("{\"index\":\"MD_2\"}"), response));
     EXPECT_EQ(response, string(""));
 }
 
@@ -319,7 +449,32 @@ TEST_F(MotionDetectionEventTest, getLastMotionEventElapsedTime)
     EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("getLastMotionEventElapsedTime"), _T("{}"), response));
 
     EXPECT_THAT(response, ::testing::MatchesRegex(_T("\\{"
-                    "\"time\":\"[0-9]+.[0-9]+\","
+                    "\"time\":[0-9.e+-]+,"
+                    "\"success\":true"
+                    "\\}")));
+}
+
+TEST_F(MotionDetectionEventTest, getLastMotionEventElapsedTimeIndex)
+{
+    ASSERT_NE(nullptr, halEventCallback);
+
+    MOTION_DETECTION_EventMessage_t eventMsg;
+    memset(&eventMsg, 0, sizeof(eventMsg));
+    strncpy(eventMsg.m_sensorIndex, MOTION_DETECTOR, sizeof(eventMsg.m_sensorIndex) - 1);
+    eventMsg.m_eventType = static_cast<decltype(eventMsg.m_eventType)>('1');
+    EXPECT_EQ(MOTION_DETECTION_RESULT_SUCCESS, halEventCallback(eventMsg));
+
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("getLastMotionEventElapsedTime"), _T("{\"index\":\"FP_MD\",\"wallClock\":true}"), response));
+    EXPECT_THAT(response, ::testing::MatchesRegex(_T("\\{"
+                    "\"time\":[0-9.e+-]+,"
+                    "\"wallClockTime\":[0-9]+,"
+                    "\"success\":true"
+                    "\\}")));
+
+    // No event from MD_2 yet, answered with the time since the plugin started.
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("getLastMotionEventElapsedTime"), _T("{\"index\":\"MD_2\"}"), response));
+    EXPECT_THAT(response, ::testing::MatchesRegex(_T("\\{"
+                    "\"time\":[0-9.e+-]+,"
                     "\"success\":true"
                     "\\}")));
 }
@@ -337,3 +492,818 @@ TEST_F(MotionDetectionEventTest, setMotionEventsActivePeriod)
     EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setMotionEventsActivePeriod"), _T("{\"nowTime\":1023,\"index\":\"FP_MD\",\"ranges\":[{\"startTime\":\"100\", \"endTime\":\"150\"}]}"), response));
     EXPECT_EQ(response,  string("{\"success\":true}"));
 }
+
+TEST_F(MotionDetectionEventTest, setMotionEventsActivePeriodNormalized)
+{
+    std::vector<std::pair<unsigned int, unsigned int>> halRanges;
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_SetActivePeriod(::testing::_,::testing::_))
+    .Times(1)
+    .WillOnce(::testing::Invoke(
+            [&](std::string index, MOTION_DETECTION_TimeRange_t timeSet) {
+                for (unsigned int range = 0; range < timeSet.m_rangeCount; range++) {
+                    halRanges.emplace_back(timeSet.m_timeRangeArray[range].m_startTime, timeSet.m_timeRangeArray[range].m_endTime);
+                }
+                return MOTION_DETECTION_RESULT_SUCCESS;
+            }));
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_GetActivePeriod(::testing::_))
+    .Times(0);
+
+    // Overlapping and adjacent ranges are merged, the overnight range is kept whole for the HAL.
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setMotionEventsActivePeriod"), _T("{\"nowTime\":1023,\"index\":\"FP_MD\",\"ranges\":[{\"startTime\":\"300\", \"endTime\":\"400\"},{\"startTime\":\"100\", \"endTime\":\"150\"},{\"startTime\":\"120\", \"endTime\":\"200\"},{\"startTime\":\"200\", \"endTime\":\"250\"},{\"startTime\":\"80000\", \"endTime\":\"50\"}]}"), response));
+    EXPECT_EQ(response,  string("{\"success\":true}"));
+    ASSERT_EQ(halRanges.size(), 3u);
+    EXPECT_EQ(halRanges[0], std::make_pair(100u, 250u));
+    EXPECT_EQ(halRanges[1], std::make_pair(300u, 400u));
+    EXPECT_EQ(halRanges[2], std::make_pair(80000u, 50u));
+
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("isMotionEventsActive"), _T("{\"time\":220}"), response));
+    EXPECT_EQ(response,  string("{\"active\":true,\"success\":true}"));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("isMotionEventsActive"), _T("{\"time\":250}"), response));
+    EXPECT_EQ(response,  string("{\"active\":false,\"success\":true}"));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("isMotionEventsActive"), _T("{\"time\":10}"), response));
+    EXPECT_EQ(response,  string("{\"active\":true,\"success\":true}"));
+}
+
+TEST_F(MotionDetectionEventTest, setMotionEventsActivePeriodInvalid)
+{
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_SetActivePeriod(::testing::_,::testing::_))
+    .Times(0);
+
+    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("setMotionEventsActivePeriod"), _T("{\"nowTime\":1023,\"index\":\"FP_MD\",\"ranges\":[{\"startTime\":\"100\", \"endTime\":\"90000\"}]}"), response));
+    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("isMotionEventsActive"), _T("{\"time\":86400}"), response));
+}
+
+TEST_F(MotionDetectionEventTest, motionEventCallbackQueuesEvent)
+{
+    ASSERT_NE(nullptr, halEventCallback);
+    EVENT_SUBSCRIBE(0, _T("onMotionEvent"), _T("client.events"), message);
+
+    const MOTION_DETECTION_EventMessage_t eventMsg = Event(MOTION_DETECTOR, '1');
+    for (int event = 0; event < 16; event++) {
+        EXPECT_EQ(MOTION_DETECTION_RESULT_SUCCESS, halEventCallback(eventMsg));
+    }
+
+    // The callback only queues, every event is notified from the dispatcher thread.
+    ASSERT_TRUE(WaitForNotifications(16));
+    for (size_t position = 0; position < 16; position++) {
+        EXPECT_THAT(Notification(position), ::testing::HasSubstr("\"method\":\"client.events.onMotionEvent\",\"params\":{\"index\":\"FP_MD\",\"mode\":\"1\"}"));
+    }
+
+    EVENT_UNSUBSCRIBE(0, _T("onMotionEvent"), _T("client.events"), message);
+}
+
+TEST_F(MotionDetectionEventTest, getMotionEventHistory)
+{
+    ASSERT_NE(nullptr, halEventCallback);
+    EVENT_SUBSCRIBE(0, _T("onMotionEvent"), _T("client.events"), message);
+
+    EXPECT_EQ(MOTION_DETECTION_RESULT_SUCCESS, halEventCallback(Event(MOTION_DETECTOR, '0')));
+    EXPECT_EQ(MOTION_DETECTION_RESULT_SUCCESS, halEventCallback(Event(MOTION_DETECTOR, '1')));
+    EXPECT_EQ(MOTION_DETECTION_RESULT_SUCCESS, halEventCallback(Event(MOTION_DETECTOR, '1')));
+
+    // Events are added to the history before they are notified.
+    ASSERT_TRUE(WaitForNotifications(3));
+
+    // A limit keeps the newest events in the range.
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("getMotionEventHistory"), _T("{\"index\":\"FP_MD\",\"limit\":2}"), response));
+    EXPECT_THAT(response, ::testing::MatchesRegex(_T("\\{"
+                "\"index\":\"FP_MD\","
+                "\"now\":[0-9]+,"
+                "\"events\":\\[\\{\"time\":[0-9]+,\"mode\":\"1\"\\},\\{\"time\":[0-9]+,\"mode\":\"1\"\\}\\],"
+                "\"success\":true"
+                "\\}")));
+
+    EVENT_UNSUBSCRIBE(0, _T("onMotionEvent"), _T("client.events"), message);
+}
+
+TEST_F(MotionDetectionEventTest, getMotionEventHistoryLargeUntil)
+{
+    ASSERT_NE(nullptr, halEventCallback);
+    EVENT_SUBSCRIBE(0, _T("onMotionEvent"), _T("client.events"), message);
+
+    EXPECT_EQ(MOTION_DETECTION_RESULT_SUCCESS, halEventCallback(Event(MOTION_DETECTOR, '1')));
+    ASSERT_TRUE(WaitForNotifications(1));
+
+    // until in nanoseconds does not fit in 64 bits, the range must still include every event.
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("getMotionEventHistory"), _T("{\"index\":\"FP_MD\",\"until\":18446744073709551}"), response));
+    EXPECT_THAT(response, ::testing::HasSubstr("\"events\":[{\"time\":"));
+
+    EVENT_UNSUBSCRIBE(0, _T("onMotionEvent"), _T("client.events"), message);
+}
+
+TEST_F(MotionDetectionEventTest, getMotionEventHistoryUnknownIndex)
+{
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("getMotionEventHistory"), _T("{\"index\":\"MD_2\"}"), response));
+    EXPECT_THAT(response, ::testing::MatchesRegex(_T("\\{"
+                    "\"index\":\"MD_2\","
+                    "\"now\":[0-9]+,"
+                    "\"events\":\\[\\],"
+                    "\"success\":true"
+                    "\\}")));
+}
+
+TEST_F(MotionDetectionEventTest, getMotionEventHistoryInvalid)
+{
+    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("getMotionEventHistory"), _T("{}"), response));
+    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("getMotionEventHistory"), _T("{\"index\":\"FP_MD\",\"since\":20,\"until\":10}"), response));
+}
+
+TEST_F(MotionDetectionEventTest, setEventCoalescing)
+{
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setEventCoalescing"), _T("{\"index\":\"FP_MD\",\"window\":500}"), response));
+    EXPECT_EQ(response,  string("{\"success\":true}"));
+
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setEventCoalescing"), _T("{\"index\":\"FP_MD\",\"window\":0}"), response));
+    EXPECT_EQ(response,  string("{\"success\":true}"));
+}
+
+TEST_F(MotionDetectionEventTest, setEventCoalescingInvalid)
+{
+    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("setEventCoalescing"), _T("{\"index\":\"FP_MD\"}"), response));
+    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("setEventCoalescing"), _T("{\"index\":\"FP_MD\",\"window\":600000}"), response));
+}
+
+TEST_F(MotionDetectionEventTest, setEventCoalescingUnknownIndex)
+{
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_GetNoMotionPeriod(::testing::_,::testing::_))
+    .Times(1)
+    .WillOnce(::testing::Invoke(
+            [](std::string index, unsigned int *noMotionPeriod) {
+                return MOTION_DETECTION_RESULT_INDEX_ERROR;
+            }));
+
+    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("setEventCoalescing"), _T("{\"index\":\"MD_2\",\"window\":500}"), response));
+}
+
+TEST_F(MotionDetectionEventTest, eventCoalescingWindow)
+{
+    ASSERT_NE(nullptr, halEventCallback);
+    EVENT_SUBSCRIBE(0, _T("onMotionEvent"), _T("client.events"), message);
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setEventCoalescing"), _T("{\"index\":\"FP_MD\",\"window\":200}"), response));
+
+    for (int event = 0; event < 3; event++) {
+        EXPECT_EQ(MOTION_DETECTION_RESULT_SUCCESS, halEventCallback(Event(MOTION_DETECTOR, '1')));
+    }
+
+    // One notification when the window closes, for all events inside it.
+    ASSERT_TRUE(WaitForNotifications(1));
+    JsonObject params = Params(Notification(0));
+    EXPECT_EQ(string(MOTION_DETECTOR), params["index"].String());
+    EXPECT_EQ(string("1"), params["mode"].String());
+    EXPECT_EQ(3, params["count"].Number());
+    EXPECT_LE(params["firstTime"].Number(), params["lastTime"].Number());
+    EXPECT_LT(params["lastTime"].Number() - params["firstTime"].Number(), 200);
+
+    // An event after the window closed starts a window of its own.
+    EXPECT_EQ(MOTION_DETECTION_RESULT_SUCCESS, halEventCallback(Event(MOTION_DETECTOR, '1')));
+    ASSERT_TRUE(WaitForNotifications(2));
+    params = Params(Notification(1));
+    EXPECT_EQ(1, params["count"].Number());
+    EXPECT_EQ(params["firstTime"].Number(), params["lastTime"].Number());
+    EXPECT_GT(params["firstTime"].Number(), Params(Notification(0))["lastTime"].Number());
+
+    {
+        std::lock_guard<std::mutex> lock(notifyLock);
+        EXPECT_EQ(2u, notifications.size());
+    }
+    EVENT_UNSUBSCRIBE(0, _T("onMotionEvent"), _T("client.events"), message);
+}
+
+TEST_F(MotionDetectionEventTest, getNoMotionPeriodCached)
+{
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_SetNoMotionPeriod(::testing::_,::testing::_))
+    .Times(1)
+    .WillOnce(::testing::Return(MOTION_DETECTION_RESULT_SUCCESS));
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_GetNoMotionPeriod(::testing::_,::testing::_))
+    .Times(0);
+
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setNoMotionPeriod"), _T("{\"index\":\"FP_MD\",\"period\":\"25\"}"), response));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("getNoMotionPeriod"), _T("{\"index\":\"FP_MD\"}"), response));
+    EXPECT_EQ(response,  string("{\"period\":\"25\",\"success\":true}"));
+}
+
+TEST_F(MotionDetectionEventTest, getSensitivityCached)
+{
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_SetSensitivity(::testing::_,::testing::_,::testing::_))
+    .Times(1)
+    .WillOnce(::testing::Return(MOTION_DETECTION_RESULT_SUCCESS));
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_GetSensitivity(::testing::_,::testing::_,::testing::_))
+    .Times(0);
+
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setSensitivity"), _T("{\"index\":\"FP_MD\",\"name\":\"high\"}"), response));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("getSensitivity"), _T("{\"index\":\"FP_MD\"}"), response));
+    EXPECT_EQ(response,  string("{\"name\":\"high\",\"success\":true}"));
+}
+
+TEST_F(MotionDetectionEventTest, refresh)
+{
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_GetNoMotionPeriod(::testing::_,::testing::_))
+    .Times(1)
+    .WillOnce(::testing::Invoke(
+            [](std::string index, unsigned int *noMotionPeriod) {
+                *noMotionPeriod = 30;
+                return MOTION_DETECTION_RESULT_SUCCESS;
+            }));
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_GetSensitivity(::testing::_,::testing::_,::testing::_))
+    .Times(1)
+    .WillOnce(::testing::Invoke(
+            [](std::string index, char** sensitivity, int* currentMode) {
+                *currentMode = 2;
+                *sensitivity = strdup(STR_SENSITIVITY_LOW);
+                return MOTION_DETECTION_RESULT_SUCCESS;
+            }));
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_GetActivePeriod(::testing::_))
+    .Times(1)
+    .WillOnce(::testing::Invoke(
+            [](MOTION_DETECTION_TimeRange_t* timeSet) {
+                timeSet->m_rangeCount = 0;
+                return MOTION_DETECTION_RESULT_SUCCESS;
+            }));
+
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("refresh"), _T("{\"index\":\"FP_MD\"}"), response));
+    EXPECT_EQ(response,  string("{\"success\":true}"));
+
+    // Served from the refreshed cache.
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("getNoMotionPeriod"), _T("{\"index\":\"FP_MD\"}"), response));
+    EXPECT_EQ(response,  string("{\"period\":\"30\",\"success\":true}"));
+}
+
+TEST_F(MotionDetectionEventTest, configureDetectors)
+{
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_GetNoMotionPeriod(::testing::_,::testing::_))
+    .Times(1)
+    .WillOnce(::testing::Invoke(
+            [](std::string index, unsigned int *noMotionPeriod) {
+                *noMotionPeriod = 10;
+                return MOTION_DETECTION_RESULT_SUCCESS;
+            }));
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_SetNoMotionPeriod(::testing::_,20))
+    .Times(1)
+    .WillOnce(::testing::Return(MOTION_DETECTION_RESULT_SUCCESS));
+    // The previous arm state comes from the cache.
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_IsMotionDetectorArmed(::testing::_,::testing::_))
+    .Times(0);
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_ArmMotionDetector(::testing::_,::testing::_))
+    .Times(1)
+    .WillOnce(::testing::Return(MOTION_DETECTION_RESULT_SUCCESS));
+
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("configureDetectors"), _T("{\"detectors\":[{\"index\":\"FP_MD\",\"period\":\"20\",\"mode\":\"1\"}]}"), response));
+    EXPECT_EQ(response,  string("{\"results\":[{\"index\":\"FP_MD\",\"success\":true,\"status\":\"applied\"}],\"success\":true}"));
+}
+
+TEST_F(MotionDetectionEventTest, configureDetectorsRollback)
+{
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_GetNoMotionPeriod(::testing::_,::testing::_))
+    .Times(1)
+    .WillOnce(::testing::Invoke(
+            [](std::string index, unsigned int *noMotionPeriod) {
+                *noMotionPeriod = 10;
+                return MOTION_DETECTION_RESULT_SUCCESS;
+            }));
+    ::testing::InSequence sequence;
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_SetNoMotionPeriod(::testing::_,20))
+    .Times(1)
+    .WillOnce(::testing::Return(MOTION_DETECTION_RESULT_SUCCESS));
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_ArmMotionDetector(::testing::_,::testing::_))
+    .Times(1)
+    .WillOnce(::testing::Return(MOTION_DETECTION_RESULT_INDEX_ERROR));
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_SetNoMotionPeriod(::testing::_,10))
+    .Times(1)
+    .WillOnce(::testing::Return(MOTION_DETECTION_RESULT_SUCCESS));
+
+    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("configureDetectors"), _T("{\"detectors\":[{\"index\":\"FP_MD\",\"period\":\"20\",\"mode\":\"1\"}]}"), response));
+}
+
+TEST_F(MotionDetectionEventTest, configureDetectorsRollbackIncomplete)
+{
+    // No active period set yet, so the previous one cannot be restored.
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_GetActivePeriod(::testing::_))
+    .Times(1)
+    .WillOnce(::testing::Return(MOTION_DETECTION_RESULT_INDEX_ERROR));
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_SetActivePeriod(::testing::_,::testing::_))
+    .Times(1)
+    .WillOnce(::testing::Return(MOTION_DETECTION_RESULT_SUCCESS));
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_GetNoMotionPeriod(::testing::_,::testing::_))
+    .Times(1)
+    .WillOnce(::testing::Invoke(
+            [](std::string index, unsigned int *noMotionPeriod) {
+                *noMotionPeriod = 10;
+                return MOTION_DETECTION_RESULT_SUCCESS;
+            }));
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_SetNoMotionPeriod(::testing::_,20))
+    .Times(1)
+    .WillOnce(::testing::Return(MOTION_DETECTION_RESULT_INDEX_ERROR));
+
+    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("configureDetectors"), _T("{\"detectors\":[{\"index\":\"FP_MD\",\"nowTime\":1023,\"ranges\":[{\"startTime\":\"100\", \"endTime\":\"150\"}]},{\"index\":\"FP_MD\",\"period\":\"20\"}]}"), response));
+    EXPECT_EQ(response,  string("{\"results\":[{\"index\":\"FP_MD\",\"success\":false,\"status\":\"rollbackFailed\"},{\"index\":\"FP_MD\",\"success\":false,\"status\":\"failed\",\"error\":\"Failed to set no motion period\"}],\"rollbackComplete\":false,\"success\":false}"));
+}
+
+TEST_F(MotionDetectionEventTest, configureDetectorsInvalid)
+{
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_SetNoMotionPeriod(::testing::_,::testing::_))
+    .Times(0);
+
+    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("configureDetectors"), _T("{}"), response));
+    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("configureDetectors"), _T("{\"detectors\":[{\"index\":\"FP_MD\",\"period\":\"20\"},{\"period\":\"20\"}]}"), response));
+}
+
+TEST_F(MotionDetectionEventTest, getPresence)
+{
+    ASSERT_NE(nullptr, halEventCallback);
+
+    // A one second no motion period drives the transitions.
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_SetNoMotionPeriod(::testing::_,::testing::_))
+    .Times(1)
+    .WillOnce(::testing::Return(MOTION_DETECTION_RESULT_SUCCESS));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setNoMotionPeriod"), _T("{\"index\":\"FP_MD\",\"period\":\"1\"}"), response));
+
+    MOTION_DETECTION_EventMessage_t eventMsg;
+    memset(&eventMsg, 0, sizeof(eventMsg));
+    strncpy(eventMsg.m_sensorIndex, MOTION_DETECTOR, sizeof(eventMsg.m_sensorIndex) - 1);
+    eventMsg.m_eventType = static_cast<decltype(eventMsg.m_eventType)>('1');
+    EXPECT_EQ(MOTION_DETECTION_RESULT_SUCCESS, halEventCallback(eventMsg));
+
+    const char* expected[] = { "present", "uncertain", "absent" };
+    for (auto state : expected) {
+        bool found = false;
+        for (int retry = 0; (retry < 400) && !found; retry++) {
+            EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("getPresence"), _T("{\"index\":\"FP_MD\"}"), response));
+            found = (response.find(string("\"state\":\"") + state + "\"") != string::npos);
+            if (!found) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+        EXPECT_TRUE(found) << state << ": " << response;
+    }
+}
+
+TEST_F(MotionDetectionEventTest, getPresenceNoMotionEvent)
+{
+    ASSERT_NE(nullptr, halEventCallback);
+    EVENT_SUBSCRIBE(0, _T("onMotionEvent"), _T("client.events"), message);
+
+    // Presence is updated before the event is notified.
+    EXPECT_EQ(MOTION_DETECTION_RESULT_SUCCESS, halEventCallback(Event(MOTION_DETECTOR, '0')));
+    ASSERT_TRUE(WaitForNotifications(1));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("getPresence"), _T("{\"index\":\"FP_MD\"}"), response));
+    EXPECT_THAT(response, ::testing::HasSubstr("\"state\":\"uncertain\""));
+
+    EXPECT_EQ(MOTION_DETECTION_RESULT_SUCCESS, halEventCallback(Event(MOTION_DETECTOR, '1')));
+    ASSERT_TRUE(WaitForNotifications(2));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("getPresence"), _T("{\"index\":\"FP_MD\"}"), response));
+    EXPECT_THAT(response, ::testing::HasSubstr("\"state\":\"present\""));
+
+    EXPECT_EQ(MOTION_DETECTION_RESULT_SUCCESS, halEventCallback(Event(MOTION_DETECTOR, '0')));
+    ASSERT_TRUE(WaitForNotifications(3));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("getPresence"), _T("{\"index\":\"FP_MD\"}"), response));
+    EXPECT_THAT(response, ::testing::HasSubstr("\"state\":\"uncertain\""));
+
+    EVENT_UNSUBSCRIBE(0, _T("onMotionEvent"), _T("client.events"), message);
+}
+
+TEST_F(MotionDetectionEventTest, getPresenceInvalid)
+{
+    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("getPresence"), _T("{}"), response));
+    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("getPresence"), _T("{\"index\":\"MD_2\"}"), response));
+}
+
+TEST_F(MotionDetectionEventTest, setEventFilter)
+{
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setEventFilter"), _T("{\"id\":\"client.events.1\",\"indexes\":[\"FP_MD\"],\"eventTypes\":[\"1\"]}"), response));
+    EXPECT_EQ(response,  string("{\"success\":true}"));
+
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setEventFilter"), _T("{\"id\":\"client.events.2\",\"eventTypes\":[\"0\",\"1\"]}"), response));
+    EXPECT_EQ(response,  string("{\"success\":true}"));
+
+    // Without indexes and event types the filter is removed again.
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setEventFilter"), _T("{\"id\":\"client.events.1\"}"), response));
+    EXPECT_EQ(response,  string("{\"success\":true}"));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setEventFilter"), _T("{\"id\":\"client.events.2\"}"), response));
+    EXPECT_EQ(response,  string("{\"success\":true}"));
+}
+
+TEST_F(MotionDetectionEventTest, setEventFilterDelivery)
+{
+    ASSERT_NE(nullptr, halEventCallback);
+    EVENT_SUBSCRIBE(0, _T("onMotionEvent"), _T("client.events.1"), message);
+    EVENT_SUBSCRIBE(0, _T("onMotionEvent"), _T("client.events.2"), message);
+
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setEventFilter"), _T("{\"id\":\"client.events.1\",\"eventTypes\":[\"1\"]}"), response));
+
+    // The no motion event only reaches the unfiltered client, the motion event both.
+    EXPECT_EQ(MOTION_DETECTION_RESULT_SUCCESS, halEventCallback(Event(MOTION_DETECTOR, '0')));
+    EXPECT_EQ(MOTION_DETECTION_RESULT_SUCCESS, halEventCallback(Event(MOTION_DETECTOR, '1')));
+    ASSERT_TRUE(WaitForNotifications(3));
+
+    std::vector<string> filtered;
+    for (size_t position = 0; position < 3; position++) {
+        const string notification = Notification(position);
+        if (notification.find("\"method\":\"client.events.1.onMotionEvent\"") != string::npos) {
+            filtered.push_back(notification);
+        }
+    }
+    ASSERT_EQ(1u, filtered.size());
+    EXPECT_THAT(filtered[0], ::testing::HasSubstr("\"mode\":\"1\""));
+
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setEventFilter"), _T("{\"id\":\"client.events.1\"}"), response));
+    EVENT_UNSUBSCRIBE(0, _T("onMotionEvent"), _T("client.events.2"), message);
+    EVENT_UNSUBSCRIBE(0, _T("onMotionEvent"), _T("client.events.1"), message);
+}
+
+TEST_F(MotionDetectionEventTest, setEventFilterOtherConnection)
+{
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setEventFilter"), _T("{\"id\":\"client.events.1\",\"eventTypes\":[\"1\"]}"), response));
+
+    {
+        // Another client connection, channel 2, may neither change nor clear it.
+        DECL_CORE_JSONRPC_CONX INIT_CONX(2, 0);
+        EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("setEventFilter"), _T("{\"id\":\"client.events.1\",\"eventTypes\":[\"0\"]}"), response));
+        EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("setEventFilter"), _T("{\"id\":\"client.events.1\"}"), response));
+        EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("setEventEncoding"), _T("{\"id\":\"client.events.1\",\"encoding\":\"compact\"}"), response));
+    }
+
+    // The owner can.
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setEventFilter"), _T("{\"id\":\"client.events.1\"}"), response));
+    EXPECT_EQ(response,  string("{\"success\":true}"));
+}
+
+TEST_F(MotionDetectionEventTest, setEventFilterInvalid)
+{
+    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("setEventFilter"), _T("{\"indexes\":[\"FP_MD\"]}"), response));
+    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("setEventFilter"), _T("{\"id\":\"client.events.1\",\"eventTypes\":[\"motion\"]}"), response));
+    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("setEventFilter"), _T("{\"id\":\"client.events.1\",\"indexes\":[\"\"]}"), response));
+}
+
+TEST_F(MotionDetectionEventTest, setEventEncoding)
+{
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setEventEncoding"), _T("{\"id\":\"client.events.1\",\"encoding\":\"compact\"}"), response));
+    EXPECT_EQ(response,  string("{\"success\":true}"));
+
+    // Filters and the encoding are independent, clearing the filter keeps the encoding.
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setEventFilter"), _T("{\"id\":\"client.events.1\",\"indexes\":[\"FP_MD\"]}"), response));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setEventFilter"), _T("{\"id\":\"client.events.1\"}"), response));
+
+    ASSERT_NE(nullptr, halEventCallback);
+    MOTION_DETECTION_EventMessage_t eventMsg;
+    memset(&eventMsg, 0, sizeof(eventMsg));
+    strncpy(eventMsg.m_sensorIndex, MOTION_DETECTOR, sizeof(eventMsg.m_sensorIndex) - 1);
+    eventMsg.m_eventType = static_cast<decltype(eventMsg.m_eventType)>('1');
+    EXPECT_EQ(MOTION_DETECTION_RESULT_SUCCESS, halEventCallback(eventMsg));
+
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setEventEncoding"), _T("{\"id\":\"client.events.1\",\"encoding\":\"json\"}"), response));
+    EXPECT_EQ(response,  string("{\"success\":true}"));
+}
+
+static std::vector<uint8_t> decodeBase64(const string& text)
+{
+    static const string alphabet("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/");
+    std::vector<uint8_t> bytes;
+    uint32_t bits = 0;
+    int count = 0;
+    for (char c : text) {
+        const size_t value = alphabet.find(c);
+        if (value == string::npos) {
+            break;
+        }
+        bits = (bits << 6) | static_cast<uint32_t>(value);
+        count += 6;
+        if (count >= 8) {
+            count -= 8;
+            bytes.push_back(static_cast<uint8_t>(bits >> count));
+        }
+    }
+    return bytes;
+}
+
+TEST_F(MotionDetectionEventTest, setEventEncodingCompactRecord)
+{
+    ASSERT_NE(nullptr, halEventCallback);
+    EVENT_SUBSCRIBE(0, _T("onMotionEvent"), _T("client.events.1"), message);
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setEventEncoding"), _T("{\"id\":\"client.events.1\",\"encoding\":\"compact\"}"), response));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setEventCoalescing"), _T("{\"index\":\"FP_MD\",\"window\":100}"), response));
+
+    EXPECT_EQ(MOTION_DETECTION_RESULT_SUCCESS, halEventCallback(Event(MOTION_DETECTOR, '1')));
+    EXPECT_EQ(MOTION_DETECTION_RESULT_SUCCESS, halEventCallback(Event(MOTION_DETECTOR, '1')));
+    ASSERT_TRUE(WaitForNotifications(1));
+
+    const string notification = Notification(0);
+    EXPECT_THAT(notification, ::testing::HasSubstr("\"method\":\"client.events.1.onMotionEvent\""));
+    const std::vector<uint8_t> record = decodeBase64(Params(notification)["record"].String());
+
+    const size_t indexLength = strlen(MOTION_DETECTOR);
+    ASSERT_EQ(3 + indexLength + 4 + 8 + 8, record.size());
+    EXPECT_EQ(1, record[0]);
+    EXPECT_EQ('1', record[1]);
+    EXPECT_EQ(indexLength, record[2]);
+    EXPECT_EQ(string(MOTION_DETECTOR), string(reinterpret_cast<const char*>(&record[3]), indexLength));
+
+    size_t position = 3 + indexLength;
+    uint32_t count = 0;
+    for (int byte = 0; byte < 4; byte++) {
+        count |= static_cast<uint32_t>(record[position++]) << (8 * byte);
+    }
+    uint64_t firstTime = 0;
+    for (int byte = 0; byte < 8; byte++) {
+        firstTime |= static_cast<uint64_t>(record[position++]) << (8 * byte);
+    }
+    uint64_t lastTime = 0;
+    for (int byte = 0; byte < 8; byte++) {
+        lastTime |= static_cast<uint64_t>(record[position++]) << (8 * byte);
+    }
+    EXPECT_EQ(2u, count);
+    EXPECT_NE(0u, firstTime);
+    EXPECT_LE(firstTime, lastTime);
+    EXPECT_LT(lastTime - firstTime, 100u);
+
+    // A compact client gets only the record, never the JSON fields as well.
+    {
+        std::lock_guard<std::mutex> lock(notifyLock);
+        EXPECT_EQ(1u, notifications.size());
+    }
+
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setEventEncoding"), _T("{\"id\":\"client.events.1\",\"encoding\":\"json\"}"), response));
+    EVENT_UNSUBSCRIBE(0, _T("onMotionEvent"), _T("client.events.1"), message);
+}
+
+TEST_F(MotionDetectionEventTest, setEventEncodingInvalid)
+{
+    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("setEventEncoding"), _T("{\"id\":\"client.events.1\"}"), response));
+    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("setEventEncoding"), _T("{\"id\":\"client.events.1\",\"encoding\":\"xml\"}"), response));
+}
+
+TEST_F(MotionDetectionEventTest, getPerformanceMetrics)
+{
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("resetPerformanceMetrics"), _T("{}"), response));
+    EXPECT_EQ(response,  string("{\"success\":true}"));
+
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_ArmMotionDetector(::testing::_,::testing::_))
+    .Times(1)
+    .WillOnce(::testing::Return(MOTION_DETECTION_RESULT_SUCCESS));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("arm"), _T("{\"index\":\"FP_MD\",\"mode\":\"1\" }"), response));
+
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("getPerformanceMetrics"), _T("{}"), response));
+    EXPECT_THAT(response, ::testing::HasSubstr("\"MOTION_DETECTION_ArmMotionDetector\":{\"count\":1,"));
+    EXPECT_THAT(response, ::testing::HasSubstr("\"MOTION_DETECTION_DisarmMotionDetector\":{\"count\":0,"));
+    EXPECT_THAT(response, ::testing::HasSubstr("\"queue\":{\"dropped\":0,"));
+
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("resetPerformanceMetrics"), _T("{}"), response));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("getPerformanceMetrics"), _T("{}"), response));
+    EXPECT_THAT(response, ::testing::HasSubstr("\"MOTION_DETECTION_ArmMotionDetector\":{\"count\":0,"));
+}
+
+TEST_F(MotionDetectionTest, asyncInitialize)
+{
+    NiceMock<ServiceMock> service;
+    ON_CALL(service, ConfigLine())
+        .WillByDefault(::testing::Return(string("{\"asyncinit\":true,\"readytimeout\":0}")));
+
+    NiceMock<MotionDetectionImplMock> halMock;
+    MotionDetection::setImpl(&halMock);
+
+    // md-hal bring-up blocks until the test releases it.
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    ON_CALL(halMock, MOTION_DETECTION_Platform_Init())
+        .WillByDefault(::testing::Invoke(
+            [released]() {
+                released.wait();
+                return MOTION_DETECTION_RESULT_SUCCESS;
+            }));
+    ON_CALL(halMock, MOTION_DETECTION_IsMotionDetectorArmed(::testing::_,::testing::_))
+        .WillByDefault(::testing::Invoke(
+            [](std::string index, bool *isArmed) {
+                *isArmed = true;
+                return MOTION_DETECTION_RESULT_SUCCESS;
+            }));
+
+    EXPECT_EQ(string(""), plugin->Initialize(&service));
+    EXPECT_EQ(Core::ERROR_UNAVAILABLE, handler.Invoke(connection, _T("isarmed"), _T("{\"index\":\"FP_MD\"}"), response));
+
+    release.set_value();
+    uint32_t status = Core::ERROR_UNAVAILABLE;
+    for (int retry = 0; (retry < 400) && (status == Core::ERROR_UNAVAILABLE); retry++) {
+        status = handler.Invoke(connection, _T("isarmed"), _T("{\"index\":\"MD_2\"}"), response);
+        if (status == Core::ERROR_UNAVAILABLE) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    EXPECT_EQ(Core::ERROR_NONE, status);
+    EXPECT_EQ(response,  string("{\"state\":true,\"success\":true}"));
+
+    plugin->Deinitialize(&service);
+    MotionDetection::setImpl(nullptr);
+}
+
+TEST_F(MotionDetectionEventTest, setEventRecording)
+{
+    ASSERT_NE(nullptr, halEventCallback);
+
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setEventRecording"), _T("{\"enable\":true}"), response));
+    EXPECT_EQ(response,  string("{\"path\":\"/tmp/motiondetection-events.bin\",\"events\":0,\"success\":true}"));
+
+    MOTION_DETECTION_EventMessage_t eventMsg;
+    memset(&eventMsg, 0, sizeof(eventMsg));
+    strncpy(eventMsg.m_sensorIndex, MOTION_DETECTOR, sizeof(eventMsg.m_sensorIndex) - 1);
+    eventMsg.m_eventType = static_cast<decltype(eventMsg.m_eventType)>('1');
+    for (int event = 0; event < 3; event++) {
+        EXPECT_EQ(MOTION_DETECTION_RESULT_SUCCESS, halEventCallback(eventMsg));
+    }
+
+    // Events are recorded by the dispatcher thread before they reach the history.
+    bool found = false;
+    for (int retry = 0; (retry < 100) && !found; retry++) {
+        EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("getMotionEventHistory"), _T("{\"index\":\"FP_MD\",\"limit\":3}"), response));
+        found = ::testing::Matches(::testing::MatchesRegex(_T(".*"
+                    "\\{\"time\":[0-9]+,\"mode\":\"1\"\\},"
+                    "\\{\"time\":[0-9]+,\"mode\":\"1\"\\},"
+                    "\\{\"time\":[0-9]+,\"mode\":\"1\"\\}\\].*")))(response);
+        if (!found) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    EXPECT_TRUE(found) << response;
+
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setEventRecording"), _T("{\"enable\":false}"), response));
+    EXPECT_EQ(response,  string("{\"path\":\"/tmp/motiondetection-events.bin\",\"events\":3,\"success\":true}"));
+
+    Plugin::MotionEventLogReader reader;
+    ASSERT_TRUE(reader.Open("/tmp/motiondetection-events.bin"));
+    Plugin::MotionEventLog::Entry entry;
+    for (int event = 0; event < 3; event++) {
+        ASSERT_TRUE(reader.Read(entry));
+        EXPECT_EQ(string(MOTION_DETECTOR), string(entry.index));
+        EXPECT_EQ('1', entry.eventType);
+    }
+    EXPECT_FALSE(reader.Read(entry));
+}
+
+TEST_F(MotionDetectionEventTest, setEventRecordingInvalid)
+{
+    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("setEventRecording"), _T("{}"), response));
+}
+
+TEST_F(MotionDetectionEventTest, setArmSchedule)
+{
+    // A whole day schedule arms once; setting it again finds the detector armed already.
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_ArmMotionDetector(::testing::_,::testing::_))
+    .Times(1)
+    .WillOnce(::testing::Return(MOTION_DETECTION_RESULT_SUCCESS));
+
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setArmSchedule"), _T("{\"index\":\"FP_MD\",\"mode\":\"1\",\"ranges\":[{\"startTime\":\"0\", \"endTime\":\"86400\"}]}"), response));
+    EXPECT_EQ(response,  string("{\"success\":true}"));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setArmSchedule"), _T("{\"index\":\"FP_MD\",\"mode\":\"1\",\"ranges\":[{\"startTime\":\"0\", \"endTime\":\"86400\"}]}"), response));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("isarmed"), _T("{\"index\":\"FP_MD\"}"), response));
+    EXPECT_EQ(response,  string("{\"state\":true,\"success\":true}"));
+}
+
+TEST_F(MotionDetectionEventTest, setArmScheduleInvalid)
+{
+    EXPECT_CALL(*p_motionDetectionImplMock, MOTION_DETECTION_ArmMotionDetector(::testing::_,::testing::_))
+    .Times(0);
+
+    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("setArmSchedule"), _T("{\"index\":\"FP_MD\",\"ranges\":[{\"startTime\":\"0\", \"endTime\":\"86400\"}]}"), response));
+    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("setArmSchedule"), _T("{\"index\":\"FP_MD\",\"mode\":\"1\",\"ranges\":[{\"startTime\":\"90000\", \"endTime\":\"100\"}]}"), response));
+    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("setArmSchedule"), _T("{\"index\":\"FP_MD\",\"mode\":\"1\"}"), response));
+}
+
+TEST_F(MotionDetectionEventTest, getArmSchedule)
+{
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setArmSchedule"), _T("{\"index\":\"FP_MD\",\"mode\":\"1\",\"ranges\":[{\"startTime\":\"80000\", \"endTime\":\"3600\"}]}"), response));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("getArmSchedule"), _T("{\"index\":\"FP_MD\"}"), response));
+    EXPECT_EQ(response,  string("{\"ranges\":[{\"startTime\":\"80000\",\"endTime\":\"3600\"}],\"mode\":\"1\",\"success\":true}"));
+
+    // No ranges clears the schedule.
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setArmSchedule"), _T("{\"index\":\"FP_MD\",\"ranges\":[]}"), response));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("getArmSchedule"), _T("{\"index\":\"FP_MD\"}"), response));
+    EXPECT_EQ(response,  string("{\"message\":\"No Arm Schedule Set\",\"success\":true}"));
+}
+
+TEST_F(MotionDetectionTest, telemetryIntervalFlush)
+{
+    NiceMock<ServiceMock> service;
+    ON_CALL(service, ConfigLine())
+        .WillByDefault(::testing::Return(string("{\"telemetryinterval\":1}")));
+
+    NiceMock<MotionDetectionImplMock> halMock;
+    MotionDetection::setImpl(&halMock);
+    MOTION_DETECTION_Result_t (*halEventCallback)(MOTION_DETECTION_EventMessage_t) = nullptr;
+    ON_CALL(halMock, MOTION_DETECTION_RegisterEventCallback(::testing::_))
+        .WillByDefault(::testing::Invoke(
+            [&](auto callback) {
+                halEventCallback = callback;
+                return MOTION_DETECTION_RESULT_SUCCESS;
+            }));
+
+    // The events of an interval are reported as one summed marker.
+    NiceMock<TelemetryApiImplMock> telemetryMock;
+    TelemetryApi::setImpl(&telemetryMock);
+    std::mutex reportLock;
+    std::condition_variable reported;
+    int reports = 0;
+    int total = 0;
+    ON_CALL(telemetryMock, t2_event_d(::testing::_, ::testing::_))
+        .WillByDefault(::testing::Invoke(
+            [&](auto marker, auto value) {
+                if (string(marker) == "SYST_INFO_NotifyMotion") {
+                    std::lock_guard<std::mutex> lock(reportLock);
+                    reports++;
+                    total += value;
+                    reported.notify_all();
+                }
+                return T2ERROR_SUCCESS;
+            }));
+
+    EXPECT_EQ(string(""), plugin->Initialize(&service));
+    ASSERT_NE(nullptr, halEventCallback);
+
+    MOTION_DETECTION_EventMessage_t eventMsg;
+    memset(&eventMsg, 0, sizeof(eventMsg));
+    strncpy(eventMsg.m_sensorIndex, MOTION_DETECTOR, sizeof(eventMsg.m_sensorIndex) - 1);
+    eventMsg.m_eventType = static_cast<decltype(eventMsg.m_eventType)>('1');
+    for (int event = 0; event < 3; event++) {
+        EXPECT_EQ(MOTION_DETECTION_RESULT_SUCCESS, halEventCallback(eventMsg));
+    }
+
+    // Reported by the interval timer, before Deinitialize flushes the rest.
+    {
+        std::unique_lock<std::mutex> lock(reportLock);
+        EXPECT_TRUE(reported.wait_for(lock, std::chrono::seconds(5), [&]() { return (total == 3); }));
+        EXPECT_LT(reports, 3);
+    }
+
+    plugin->Deinitialize(&service);
+    TelemetryApi::setImpl(nullptr);
+    MotionDetection::setImpl(nullptr);
+}
+
+TEST_F(MotionDetectionTest, armSchedulePersisted)
+{
+    const string path("/tmp/motiondetection-armschedule-test.json");
+    std::remove(path.c_str());
+
+    NiceMock<ServiceMock> service;
+    ON_CALL(service, ConfigLine())
+        .WillByDefault(::testing::Return(string("{\"schedulepath\":\"") + path + string("\"}")));
+
+    NiceMock<MotionDetectionImplMock> halMock;
+    MotionDetection::setImpl(&halMock);
+
+    // Armed by setArmSchedule, and again from the saved schedule after the restart disarmed it.
+    EXPECT_CALL(halMock, MOTION_DETECTION_ArmMotionDetector(::testing::_,::testing::_))
+    .Times(2)
+    .WillRepeatedly(::testing::Return(MOTION_DETECTION_RESULT_SUCCESS));
+
+    EXPECT_EQ(string(""), plugin->Initialize(&service));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("setArmSchedule"), _T("{\"index\":\"FP_MD\",\"mode\":\"1\",\"ranges\":[{\"startTime\":\"0\", \"endTime\":\"86400\"}]}"), response));
+    plugin->Deinitialize(&service);
+
+    // Deinitialize unregisters the methods, the restart is a new plugin instance.
+    Core::ProxyType<Plugin::MotionDetection> restarted = Core::ProxyType<Plugin::MotionDetection>::Create();
+    Core::JSONRPC::Handler& restartedHandler = *(restarted);
+    EXPECT_EQ(string(""), restarted->Initialize(&service));
+    EXPECT_EQ(Core::ERROR_NONE, restartedHandler.Invoke(connection, _T("getArmSchedule"), _T("{\"index\":\"FP_MD\"}"), response));
+    EXPECT_EQ(response,  string("{\"ranges\":[{\"startTime\":\"0\",\"endTime\":\"86400\"}],\"mode\":\"1\",\"success\":true}"));
+    restarted->Deinitialize(&service);
+
+    MotionDetection::setImpl(nullptr);
+    std::remove(path.c_str());
+}
+
+TEST_F(MotionDetectionTest, armScheduleSaveFailure)
+{
+    NiceMock<ServiceMock> service;
+    ON_CALL(service, ConfigLine())
+        .WillByDefault(::testing::Return(string("{\"schedulepath\":\"/nonexistent/motiondetection-armschedule.json\"}")));
+
+    NiceMock<MotionDetectionImplMock> halMock;
+    MotionDetection::setImpl(&halMock);
+
+    // Nothing is applied when the schedule cannot be kept.
+    EXPECT_CALL(halMock, MOTION_DETECTION_ArmMotionDetector(::testing::_,::testing::_))
+    .Times(0);
+
+    EXPECT_EQ(string(""), plugin->Initialize(&service));
+    EXPECT_EQ(Core::ERROR_GENERAL, handler.Invoke(connection, _T("setArmSchedule"), _T("{\"index\":\"FP_MD\",\"mode\":\"1\",\"ranges\":[{\"startTime\":\"0\", \"endTime\":\"86400\"}]}"), response));
+    EXPECT_EQ(Core::ERROR_NONE, handler.Invoke(connection, _T("getArmSchedule"), _T("{\"index\":\"FP_MD\"}"), response));
+    EXPECT_EQ(response,  string("{\"message\":\"No Arm Schedule Set\",\"success\":true}"));
+    plugin->Deinitialize(&service);
+
+    MotionDetection::setImpl(nullptr);
+}
+
+TEST_F(MotionDetectionEventTest, eventCallbackAfterDeinitialize)
+{
+    ASSERT_NE(nullptr, halEventCallback);
+    const MOTION_DETECTION_EventMessage_t eventMsg = Event(MOTION_DETECTOR, '1');
+
+    plugin->Deinitialize(nullptr);
+    deinitialized = true;
+    EXPECT_EQ(MOTION_DETECTION_RESULT_INTI_FAILURE, halEventCallback(eventMsg));
+
+    // Deinitialize unregisters the methods, Initialize of a new instance publishes it again.
+    Core::ProxyType<Plugin::MotionDetection> restarted = Core::ProxyType<Plugin::MotionDetection>::Create();
+    EXPECT_EQ(string(""), restarted->Initialize(nullptr));
+    EXPECT_EQ(MOTION_DETECTION_RESULT_SUCCESS, halEventCallback(eventMsg));
+    restarted->Deinitialize(nullptr);
+    EXPECT_EQ(MOTION_DETECTION_RESULT_INTI_FAILURE, halEventCallback(eventMsg));
+}
@@ -54,6 +54,12 @@ using PowerState = WPEFramework::Exchange::IPowerManager::PowerState;
 #include "UtilsSearchRDKProfile.h"
 
 #define FP_SETTINGS_FILE_JSON "/opt/fp_service_preferences.json"
+// Frames per second of fading blink pattern entries, setBlink "frameRate" overrides it.
+#define FP_DEFAULT_FADE_FRAME_RATE 25
+#define FP_MAX_FADE_FRAME_RATE 60
+// Upper bounds of a compiled blink pattern: frames of one fading entry, steps of the whole pattern.
+#define FP_MAX_FADE_FRAMES 600
+#define FP_MAX_BLINK_STEPS 4096
 
 /*
 Requirement now
@@ -76,11 +82,6 @@ namespace WPEFramework
 
         static bool powerStatus = false;     //Check how this works on xi3 and rng's
         static bool started = false;
-        static int m_numberOfBlinks = 0;
-        static int m_maxNumberOfBlinkRepeats = 0;
-        static int m_currentBlinkListIndex = 0;
-        static std::vector<std::string> m_lights;
-        static device::List <device::FrontPanelIndicator> fpIndicators;
         static PowerManagerInterfaceRef _powerManagerPlugin;
 
         static Core::TimerType<BlinkInfo> blinkTimer(64 * 1024, "BlinkTimer");
@@ -103,6 +104,11 @@ namespace WPEFramework
                 { 0,  0}
             };
 
+            // DS names of the frontPanelIndicator values.
+            static const char* const indicatorNames[FRONT_PANEL_INDICATOR_ALL] = {
+                "Clock", "Message", "Power", "Record", "Remote", "RfByPass"
+            };
+
             std::string svc2iarm(const std::string &name)
             {
                 const char *s = name.c_str();
@@ -116,12 +122,32 @@ namespace WPEFramework
                 }
                 return name;
             }
+
+            uint64_t stepTicks(const FrontPanelAnimationStep& step)
+            {
+                return static_cast<uint64_t>(std::max(step.durationInMs, 0)) * Core::Time::TicksPerMillisecond;
+            }
+
+            unsigned int blendColor(unsigned int from, unsigned int to, int frame, int frames)
+            {
+                unsigned int color = 0;
+                for (int shift = 0; shift <= 16; shift += 8)
+                {
+                    int start = (from >> shift) & 0xFF;
+                    int end = (to >> shift) & 0xFF;
+                    color |= static_cast<unsigned int>(start + ((end - start) * frame) / frames) << shift;
+                }
+                return color;
+            }
         }
 
         CFrontPanel::CFrontPanel()
             : m_blinkTimer(this)
-            , m_isBlinking(false)
+            , m_shadowHits(0)
+            , m_shadowMisses(0)
         {
+            for (int id = 0; id < FRONT_PANEL_INDICATOR_ALL; id++)
+                m_indicatorsById[id] = nullptr;
         }
 
         CFrontPanel* CFrontPanel::instance(PluginHost::IShell *service)
@@ -142,18 +168,7 @@ namespace WPEFramework
                 try
                 {
                     LOGINFO("Front panel init");
-                    fpIndicators = device::FrontPanelConfig::getInstance().getIndicators();
-
-                    for (uint i = 0; i < fpIndicators.size(); i++)
-                    {
-                        std::string IndicatorNameIarm = fpIndicators.at(i).getName();
-
-                        auto it = std::find(m_lights.begin(), m_lights.end(), IndicatorNameIarm);
-                        if (m_lights.end() == it)
-                        {
-                            m_lights.push_back(std::move(IndicatorNameIarm));
-                        }
-                    }
+                    s_instance->buildIndicatorTable();
 
 #if defined(HAS_API_POWERSTATE)
                     {
@@ -173,19 +188,20 @@ namespace WPEFramework
                     }
 #endif
 
-                    globalLedBrightness = device::FrontPanelIndicator::getInstance("Power").getBrightness();
+                    globalLedBrightness = s_instance->indicatorHandle(FRONT_PANEL_INDICATOR_POWER).getBrightness();
                     LOGINFO("Power light brightness, %d, power status %d", globalLedBrightness, powerStatus);
 
 		    profileType = searchRdkProfile();
 		    if (TV != profileType)
 		    {
-                        for (uint i = 0; i < fpIndicators.size(); i++)
+                        for (size_t i = 0; i < s_instance->m_indicators.size(); i++)
 			{
-                            LOGWARN("Initializing light %s", fpIndicators.at(i).getName().c_str());
+                            const FrontPanelIndicatorEntry& entry = s_instance->m_indicators[i];
+                            LOGWARN("Initializing light %s", entry.name.c_str());
 			    if (powerStatus)
-                                device::FrontPanelIndicator::getInstance(fpIndicators.at(i).getName()).setBrightness(globalLedBrightness, false);
+                                s_instance->writeBrightness(*entry.handle, globalLedBrightness, false);
 
-			    device::FrontPanelIndicator::getInstance(fpIndicators.at(i).getName()).setState(false);
+			    s_instance->writeState(*entry.handle, false);
 			}
 		    }
 		    else
@@ -194,7 +210,7 @@ namespace WPEFramework
 		    }
 
 		    if (powerStatus)
-                        device::FrontPanelIndicator::getInstance("Power").setState(true);
+                        s_instance->writeState(s_instance->indicatorHandle(FRONT_PANEL_INDICATOR_POWER), true);
 
                 }
                 catch (...)
@@ -229,18 +245,11 @@ namespace WPEFramework
             LOGWARN("Front panel start");
             try
             {
-                if (powerStatus)
-                    device::FrontPanelIndicator::getInstance("Power").setState(true);
+                // Only does something if DS was not ready when the instance was created.
+                buildIndicatorTable();
 
-                device::List <device::FrontPanelIndicator> fpIndicators = device::FrontPanelConfig::getInstance().getIndicators();
-                for (uint i = 0; i < fpIndicators.size(); i++)
-                {
-                    std::string IndicatorNameIarm = fpIndicators.at(i).getName();
-
-                    auto it = std::find(m_lights.begin(), m_lights.end(), IndicatorNameIarm);
-                    if (m_lights.end() == it)
-                        m_lights.push_back(std::move(IndicatorNameIarm));
-                }
+                if (powerStatus)
+                    writeState(indicatorHandle(FRONT_PANEL_INDICATOR_POWER), true);
             }
             catch (...)
             {
@@ -248,9 +257,6 @@ namespace WPEFramework
             }
             if (!started)
             {
-                m_numberOfBlinks = 0;
-                m_maxNumberOfBlinkRepeats = 0;
-                m_currentBlinkListIndex = 0;
                 started = true;
             }
             return true;
@@ -265,6 +271,8 @@ namespace WPEFramework
         void CFrontPanel::setPowerStatus(bool bPowerStatus)
         {
             powerStatus = bPowerStatus;
+            // dsMgr may have changed the LEDs on the power transition.
+            invalidateShadowStates();
         }
 
         std::string CFrontPanel::getLastError()
@@ -293,9 +301,9 @@ namespace WPEFramework
 
             try
             {
-                for (uint i = 0; i < fpIndicators.size(); i++)
+                for (size_t i = 0; i < m_indicators.size(); i++)
                 {
-                    device::FrontPanelIndicator::getInstance(fpIndicators.at(i).getName()).setBrightness(globalLedBrightness);
+                    writeBrightness(*m_indicators[i].handle, globalLedBrightness, true);
                 }
             }
             catch (...)
@@ -311,7 +319,7 @@ namespace WPEFramework
         {
             try
             {
-                globalLedBrightness = device::FrontPanelIndicator::getInstance("Power").getBrightness();
+                globalLedBrightness = indicatorHandle(FRONT_PANEL_INDICATOR_POWER).getBrightness();
                 LOGWARN("Power light brightness, %d\n", globalLedBrightness);
             }
             catch (...)
@@ -324,7 +332,7 @@ namespace WPEFramework
 
         bool CFrontPanel::powerOnLed(frontPanelIndicator fp_indicator)
         {
-            stopBlinkTimer();
+            stopIndicatorBlink(fp_indicator);
             try
             {
                 if (powerStatus)
@@ -333,28 +341,23 @@ namespace WPEFramework
                     {
                     case FRONT_PANEL_INDICATOR_MESSAGE:
                         isMessageLedOn = true;
-                        device::FrontPanelIndicator::getInstance("Message").setState(true);
+                        writeState(indicatorHandle(FRONT_PANEL_INDICATOR_MESSAGE), true);
                         break;
                     case FRONT_PANEL_INDICATOR_RECORD:
                         isRecordLedOn = true;
-                        device::FrontPanelIndicator::getInstance("Record").setState(true);
+                        writeState(indicatorHandle(FRONT_PANEL_INDICATOR_RECORD), true);
                         break;
                     case FRONT_PANEL_INDICATOR_REMOTE:
-                        device::FrontPanelIndicator::getInstance("Remote").setState(true);
-                        break;
                     case FRONT_PANEL_INDICATOR_RFBYPASS:
-                        device::FrontPanelIndicator::getInstance("RfByPass").setState(true);
+                    case FRONT_PANEL_INDICATOR_POWER:
+                        writeState(indicatorHandle(fp_indicator), true);
                         break;
                     case FRONT_PANEL_INDICATOR_ALL:
                         if (isMessageLedOn)
-                            device::FrontPanelIndicator::getInstance("Message").setState(true);
+                            writeState(indicatorHandle(FRONT_PANEL_INDICATOR_MESSAGE), true);
                         if (isRecordLedOn)
-                            device::FrontPanelIndicator::getInstance("Record").setState(true);
-                        device::FrontPanelIndicator::getInstance("Power").setState(true);
-                        break;
-                    case FRONT_PANEL_INDICATOR_POWER:
-                        //LOGWARN("CFrontPanel::powerOnLed() - FRONT_PANEL_INDICATOR_POWER not handled");
-			device::FrontPanelIndicator::getInstance("Power").setState(true);
+                            writeState(indicatorHandle(FRONT_PANEL_INDICATOR_RECORD), true);
+                        writeState(indicatorHandle(FRONT_PANEL_INDICATOR_POWER), true);
                         break;
                     default:
                         LOGERR("Invalid Indicator %d", fp_indicator);
@@ -371,37 +374,31 @@ namespace WPEFramework
 
         bool CFrontPanel::powerOffLed(frontPanelIndicator fp_indicator)
         {
-            stopBlinkTimer();
+            stopIndicatorBlink(fp_indicator);
             try
             {
                 switch (fp_indicator)
                 {
                 case FRONT_PANEL_INDICATOR_MESSAGE:
                     isMessageLedOn = false;
-                    device::FrontPanelIndicator::getInstance("Message").setState(false);
+                    writeState(indicatorHandle(FRONT_PANEL_INDICATOR_MESSAGE), false);
                     break;
                 case FRONT_PANEL_INDICATOR_RECORD:
                     isRecordLedOn = false;
-                    device::FrontPanelIndicator::getInstance("Record").setState(false);
+                    writeState(indicatorHandle(FRONT_PANEL_INDICATOR_RECORD), false);
                     break;
                 case FRONT_PANEL_INDICATOR_REMOTE:
-                    device::FrontPanelIndicator::getInstance("Remote").setState(false);
-                    break;
                 case FRONT_PANEL_INDICATOR_RFBYPASS:
-                    device::FrontPanelIndicator::getInstance("RfByPass").setState(false);
+                case FRONT_PANEL_INDICATOR_POWER:
+                    writeState(indicatorHandle(fp_indicator), false);
                     break;
                 case FRONT_PANEL_INDICATOR_ALL:
-                    for (uint i = 0; i < fpIndicators.size(); i++)
+                    for (size_t i = 0; i < m_indicators.size(); i++)
                     {
-                        //LOGWARN("powerOffLed for Indicator %s", QString::fromStdString(fpIndicators.at(i).getName()).toUtf8().constData());
-                        LOGWARN("powerOffLed for Indicator %s", fpIndicators.at(i).getName().c_str());
-                        device::FrontPanelIndicator::getInstance(fpIndicators.at(i).getName()).setState(false);
+                        LOGWARN("powerOffLed for Indicator %s", m_indicators[i].name.c_str());
+                        writeState(*m_indicators[i].handle, false);
                     }
                     break;
-                case FRONT_PANEL_INDICATOR_POWER:
-                    //LOGWARN("CFrontPanel::powerOffLed() - FRONT_PANEL_INDICATOR_POWER not handled");
-		    device::FrontPanelIndicator::getInstance("Power").setState(false);
-                    break;
                 default:
                     LOGERR("Invalid Indicator %d", fp_indicator);
                 }
@@ -429,9 +426,9 @@ namespace WPEFramework
 
         bool CFrontPanel::setLED(const JsonObject& parameters)
         {
-            stopBlinkTimer();
             bool success = false;
             string ledIndicator = svc2iarm(parameters["ledIndicator"].String());
+            stopBlink(ledIndicator);
             int brightness = -1;
 
             if (parameters.HasLabel("brightness"))
@@ -444,7 +441,7 @@ namespace WPEFramework
                 string colorString = parameters["color"].String();
                 try
                 {
-                    device::FrontPanelIndicator::getInstance(ledIndicator.c_str()).setColor(device::FrontPanelIndicator::Color::getInstance(colorString.c_str()), false);
+                    writeColorId(indicatorHandle(ledIndicator), device::FrontPanelIndicator::Color::getInstance(colorString.c_str()).getId(), false);
                     success = true;
                 }
                 catch (...)
@@ -463,7 +460,7 @@ namespace WPEFramework
                 color = (red << 16) | (green << 8) | blue;
                 try
                 {
-                    device::FrontPanelIndicator::getInstance(ledIndicator.c_str()).setColor(color);
+                    writeColor(indicatorHandle(ledIndicator), color, true);
                     success = true;
                 }
                 catch (...)
@@ -476,9 +473,9 @@ namespace WPEFramework
             try
             {
                 if (brightness == -1)
-                    brightness = device::FrontPanelIndicator::getInstance(ledIndicator.c_str()).getBrightness(true);
+                    brightness = indicatorHandle(ledIndicator).getBrightness(true);
 
-                device::FrontPanelIndicator::getInstance(ledIndicator.c_str()).setBrightness(brightness, false);
+                writeBrightness(indicatorHandle(ledIndicator), brightness, false);
                 success = true;
             }
             catch (...)
@@ -490,11 +487,15 @@ namespace WPEFramework
 
         void CFrontPanel::setBlink(const JsonObject& blinkInfo)
         {
-            stopBlinkTimer();
-            m_blinkList.clear();
+            std::vector<FrontPanelBlinkInfo> blinkList;
+            std::vector<FrontPanelAnimationStep> steps;
             string ledIndicator = svc2iarm(blinkInfo["ledIndicator"].String());
             int iterations = 0;
             getNumberParameterObject(blinkInfo, "iterations", iterations);
+            int frameRate = FP_DEFAULT_FADE_FRAME_RATE;
+            if (blinkInfo.HasLabel("frameRate"))
+                getNumberParameterObject(blinkInfo, "frameRate", frameRate);
+            frameRate = std::max(1, std::min(frameRate, FP_MAX_FADE_FRAME_RATE));
             JsonArray patternList = blinkInfo["pattern"].Array();
             for (int i = 0; i < patternList.Length(); i++)
             {
@@ -532,47 +533,516 @@ namespace WPEFramework
                 {
                     frontPanelBlinkInfo.colorMode = 0;
                 }
-                m_blinkList.push_back(std::move(frontPanelBlinkInfo));
+                frontPanelBlinkInfo.fade = frontPanelBlinkHash.HasLabel("fade") && frontPanelBlinkHash["fade"].Boolean();
+                blinkList.push_back(std::move(frontPanelBlinkInfo));
+            }
+            bool compiled = (indicatorEntry(ledIndicator) != nullptr) && compileBlink(blinkList, frameRate, steps);
+            if (!compiled)
+                LOGERR("setBlink failed for ledIndicator: %s", ledIndicator.c_str());
+
+            // Only the pattern of this indicator is replaced, a failed compile just stops it.
+            // Unknown indicators and failed patterns never get a slot of their own.
+            std::lock_guard<std::mutex> lock(m_blinkMutex);
+            FrontPanelBlinkSlot* slot = nullptr;
+            for (size_t i = 0; (i < m_blinkSlots.size()) && (slot == nullptr); i++)
+            {
+                if (m_blinkSlots[i].ledIndicator == ledIndicator)
+                    slot = &m_blinkSlots[i];
+            }
+            if (!compiled)
+            {
+                if (slot != nullptr)
+                {
+                    slot->steps.clear();
+                    slot->active = false;
+                    scheduleBlinkTimer();
+                }
+                return;
             }
-            startBlinkTimer(iterations);
+            if (slot == nullptr)
+            {
+                m_blinkSlots.push_back(FrontPanelBlinkSlot());
+                slot = &m_blinkSlots.back();
+                slot->ledIndicator = ledIndicator;
+            }
+            slot->steps.swap(steps);
+            startBlinkTimer(*slot, iterations);
+            scheduleBlinkTimer();
         }
 
-        void CFrontPanel::startBlinkTimer(int numberOfBlinkRepeats)
+        // JSON form of applyTransaction, for front panel consumers:
+        // {"indicators":[{"ledIndicator":"power_led", "state":true, "brightness":50, "color":"red"}, ...]}
+        // with the color given as "color" or "red"/"green"/"blue" like in setLED.
+        bool CFrontPanel::applyTransaction(const JsonObject& parameters)
         {
-            LOGWARN("startBlinkTimer numberOfBlinkRepeats: %d m_blinkList.length : %zu", numberOfBlinkRepeats, m_blinkList.size());
-            stopBlinkTimer();
-            m_numberOfBlinks = 0;
-            m_isBlinking = true;
-            m_maxNumberOfBlinkRepeats = numberOfBlinkRepeats;
-            m_currentBlinkListIndex = 0;
-            if (m_blinkList.size() > 0)
+            if (!parameters.HasLabel("indicators"))
             {
-                FrontPanelBlinkInfo blinkInfo = m_blinkList.at(0);
-                setBlinkLed(blinkInfo);
-                if (m_isBlinking)
-                    blinkTimer.Schedule(Core::Time::Now().Add(blinkInfo.durationInMs), m_blinkTimer);
+                LOGERR("applyTransaction: indicators missing");
+                return false;
+            }
+
+            std::vector<FrontPanelIndicatorState> states;
+            JsonArray indicatorList = parameters["indicators"].Array();
+            for (int i = 0; i < indicatorList.Length(); i++)
+            {
+                JsonObject indicatorHash = indicatorList[i].Object();
+                FrontPanelIndicatorState indicatorState;
+                indicatorState.ledIndicator = svc2iarm(indicatorHash["ledIndicator"].String());
+                indicatorState.state = -1;
+                if (indicatorHash.HasLabel("state"))
+                    indicatorState.state = indicatorHash["state"].Boolean() ? 1 : 0;
+                indicatorState.brightness = -1;
+                if (indicatorHash.HasLabel("brightness"))
+                    getNumberParameterObject(indicatorHash, "brightness", indicatorState.brightness);
+                indicatorState.colorMode = 0;
+                indicatorState.colorValue = 0;
+                if (indicatorHash.HasLabel("color") && !indicatorHash["color"].String().empty()) //color mode 2
+                {
+                    indicatorState.colorName = indicatorHash["color"].String();
+                    indicatorState.colorMode = 2;
+                }
+                else if (indicatorHash.HasLabel("red")) //color mode 1
+                {
+                    unsigned int red = 0, green = 0, blue = 0;
+
+                    getNumberParameterObject(indicatorHash, "red", red);
+                    getNumberParameterObject(indicatorHash, "green", green);
+                    getNumberParameterObject(indicatorHash, "blue", blue);
+
+                    indicatorState.colorValue = (red << 16) | (green << 8) | blue;
+                    indicatorState.colorMode = 1;
+                }
+                states.push_back(std::move(indicatorState));
             }
+            return applyTransaction(states);
+        }
+
+        // Sets several indicators in one go: every name is resolved before anything is written,
+        // the blink patterns of the indicators are stopped together, and the writes go through
+        // the shadow state under a single lock, so only settings that change reach dsMgr.
+        // Like powerOnLed, indicators are only switched on while the power status is on.
+        bool CFrontPanel::applyTransaction(const std::vector<FrontPanelIndicatorState>& states)
+        {
+            std::vector<device::FrontPanelIndicator*> indicators;
+            std::vector<int> colorIds;
+            indicators.reserve(states.size());
+            colorIds.reserve(states.size());
+            try
+            {
+                for (size_t i = 0; i < states.size(); i++)
+                {
+                    indicators.push_back(&indicatorHandle(states[i].ledIndicator));
+                    colorIds.push_back((states[i].colorMode == 2) ? device::FrontPanelIndicator::Color::getInstance(states[i].colorName.c_str()).getId() : 0);
+
+                    const FrontPanelIndicatorEntry* entry = indicatorEntry(states[i].ledIndicator);
+                    if ((states[i].colorMode == 2) && (entry != nullptr) && !entry->supportedColors.empty()
+                        && (std::find(entry->supportedColors.begin(), entry->supportedColors.end(), colorIds.back()) == entry->supportedColors.end()))
+                    {
+                        LOGERR("applyTransaction: %s does not support color %s", states[i].ledIndicator.c_str(), states[i].colorName.c_str());
+                        return false;
+                    }
+                }
+            }
+            catch (...)
+            {
+                LOGERR("Frontpanel Exception Caught during [%s] resolving indicator %zu\r\n", __func__, indicators.size());
+                return false;
+            }
+
+            std::lock_guard<std::mutex> blinkLock(m_blinkMutex);
+            for (size_t i = 0; i < m_blinkSlots.size(); i++)
+            {
+                for (size_t j = 0; j < states.size(); j++)
+                {
+                    if (m_blinkSlots[i].ledIndicator == states[j].ledIndicator)
+                        m_blinkSlots[i].active = false;
+                }
+            }
+            scheduleBlinkTimer();
+
+            std::lock_guard<std::mutex> shadowLock(m_shadowMutex);
+            bool success = true;
+            for (size_t i = 0; i < states.size(); i++)
+            {
+                const FrontPanelIndicatorState& indicatorState = states[i];
+                try
+                {
+                    FrontPanelShadowState& shadow = shadowState(*indicators[i]);
+                    if (indicatorState.colorMode == 1)
+                        updateColor(shadow, 1, indicatorState.colorValue, false);
+                    else if (indicatorState.colorMode == 2)
+                        updateColor(shadow, 2, static_cast<unsigned int>(colorIds[i]), false);
+                    if (indicatorState.brightness != -1)
+                        updateBrightness(shadow, indicatorState.brightness, false);
+                    if ((indicatorState.state == 0) || ((indicatorState.state == 1) && powerStatus))
+                    {
+                        updateState(shadow, indicatorState.state == 1);
+                        if (indicatorState.ledIndicator == "Message")
+                            isMessageLedOn = (indicatorState.state == 1);
+                        else if (indicatorState.ledIndicator == "Record")
+                            isRecordLedOn = (indicatorState.state == 1);
+                    }
+                }
+                catch (...)
+                {
+                    LOGERR("Frontpanel Exception Caught during [%s] for %s\r\n", __func__, indicatorState.ledIndicator.c_str());
+                    success = false;
+                }
+            }
+            return success;
+        }
+
+        // Resolves indicator, colors and brightness of the pattern once, and expands every fading
+        // entry into frames at frameRate that blend towards the next entry (the last one towards
+        // the first). onBlinkTimer then only applies steps.
+        bool CFrontPanel::compileBlink(const std::vector<FrontPanelBlinkInfo>& blinkList, int frameRate, std::vector<FrontPanelAnimationStep>& animation)
+        {
+            std::vector<FrontPanelAnimationStep> keyframes;
+            animation.clear();
+            if (blinkList.empty())
+                return true;
+
+            if (blinkList.size() > FP_MAX_BLINK_STEPS)
+            {
+                LOGERR("setBlink pattern has %zu entries, at most %d are supported", blinkList.size(), FP_MAX_BLINK_STEPS);
+                return false;
+            }
+
+            keyframes.reserve(blinkList.size());
+            try
+            {
+                device::FrontPanelIndicator& indicator = indicatorHandle(blinkList[0].ledIndicator);
+                int currentBrightness = -1;
+                for (size_t i = 0; i < blinkList.size(); i++)
+                {
+                    const FrontPanelBlinkInfo& blinkInfo = blinkList[i];
+                    FrontPanelAnimationStep step;
+                    step.indicator = &indicator;
+                    step.colorValue = blinkInfo.colorValue;
+                    step.colorId = 0;
+                    step.colorMode = blinkInfo.colorMode;
+                    if (blinkInfo.colorMode == 2)
+                    {
+                        try
+                        {
+                            step.colorId = device::FrontPanelIndicator::Color::getInstance(blinkInfo.colorName.c_str()).getId();
+                        }
+                        catch (...)
+                        {
+                            LOGWARN("setBlink unknown color %s", blinkInfo.colorName.c_str());
+                            step.colorMode = 0;
+                        }
+                    }
+                    step.brightness = blinkInfo.brightness;
+                    if (step.brightness == -1)
+                    {
+                        if (currentBrightness == -1)
+                            currentBrightness = indicator.getBrightness(true);
+                        step.brightness = currentBrightness;
+                    }
+                    step.durationInMs = blinkInfo.durationInMs;
+                    keyframes.push_back(step);
+                }
+            }
+            catch (...)
+            {
+                LOGERR("Frontpanel Exception Caught during [%s]\r\n", __func__);
+                return false;
+            }
+
+            for (size_t i = 0; i < keyframes.size(); i++)
+            {
+                const FrontPanelAnimationStep& from = keyframes[i];
+                int frames = 1;
+                if (blinkList[i].fade)
+                {
+                    // In 64 bits, a long duration times the frame rate overflows an int. Every
+                    // entry after this one keeps at least one step within FP_MAX_BLINK_STEPS.
+                    int64_t wanted = (static_cast<int64_t>(from.durationInMs) * frameRate) / 1000;
+                    int64_t budget = static_cast<int64_t>(FP_MAX_BLINK_STEPS) - static_cast<int64_t>(animation.size()) - static_cast<int64_t>(keyframes.size() - i - 1);
+                    frames = static_cast<int>(std::max<int64_t>(1, std::min<int64_t>(wanted, std::min<int64_t>(FP_MAX_FADE_FRAMES, budget))));
+                }
+                if (frames == 1)
+                {
+                    animation.push_back(from);
+                    continue;
+                }
+
+                const FrontPanelAnimationStep& to = keyframes[(i + 1) % keyframes.size()];
+                bool blend = (from.colorMode == 1) && (to.colorMode == 1);
+                for (int frame = 0; frame < frames; frame++)
+                {
+                    FrontPanelAnimationStep step = from;
+                    step.brightness = from.brightness + ((to.brightness - from.brightness) * frame) / frames;
+                    if (blend)
+                        step.colorValue = blendColor(from.colorValue, to.colorValue, frame, frames);
+                    else if (frame > 0)
+                        step.colorMode = 0; // color already set by the first frame
+                    // The last frame takes the remainder, so the entry keeps its duration.
+                    step.durationInMs = from.durationInMs / frames;
+                    if (frame == (frames - 1))
+                        step.durationInMs = from.durationInMs - (step.durationInMs * (frames - 1));
+                    animation.push_back(step);
+                }
+            }
+            return true;
+        }
+
+        // Called with m_blinkMutex held.
+        void CFrontPanel::startBlinkTimer(FrontPanelBlinkSlot& slot, int numberOfBlinkRepeats)
+        {
+            LOGWARN("startBlinkTimer %s numberOfBlinkRepeats: %d steps: %zu", slot.ledIndicator.c_str(), numberOfBlinkRepeats, slot.steps.size());
+            slot.numberOfBlinks = 0;
+            slot.maxNumberOfBlinkRepeats = numberOfBlinkRepeats;
+            slot.currentStep = 0;
+            slot.active = false;
+            if (slot.steps.size() > 0)
+            {
+                const FrontPanelAnimationStep& step = slot.steps[0];
+                setBlinkLed(step);
+                slot.due = Core::Time::Now().Ticks() + stepTicks(step);
+                slot.active = true;
+            }
+        }
+
+        // Called with m_blinkMutex held. The blink timer only runs for the slot due first.
+        void CFrontPanel::scheduleBlinkTimer()
+        {
+            bool pending = false;
+            uint64_t due = 0;
+            for (size_t i = 0; i < m_blinkSlots.size(); i++)
+            {
+                const FrontPanelBlinkSlot& slot = m_blinkSlots[i];
+                if (slot.active && (!pending || (slot.due < due)))
+                {
+                    due = slot.due;
+                    pending = true;
+                }
+            }
+            blinkTimer.Revoke(m_blinkTimer);
+            if (pending)
+                blinkTimer.Schedule(Core::Time(due), m_blinkTimer);
         }
 
         void CFrontPanel::stopBlinkTimer()
         {
-            m_isBlinking = false;
+            std::lock_guard<std::mutex> lock(m_blinkMutex);
+            for (size_t i = 0; i < m_blinkSlots.size(); i++)
+                m_blinkSlots[i].active = false;
             blinkTimer.Revoke(m_blinkTimer);
         }
 
-        void CFrontPanel::setBlinkLed(FrontPanelBlinkInfo blinkInfo)
+        void CFrontPanel::stopBlink(const std::string& ledIndicator)
+        {
+            std::lock_guard<std::mutex> lock(m_blinkMutex);
+            for (size_t i = 0; i < m_blinkSlots.size(); i++)
+            {
+                if (m_blinkSlots[i].ledIndicator == ledIndicator)
+                    m_blinkSlots[i].active = false;
+            }
+            scheduleBlinkTimer();
+        }
+
+        void CFrontPanel::stopIndicatorBlink(frontPanelIndicator fp_indicator)
+        {
+            if (fp_indicator == FRONT_PANEL_INDICATOR_ALL)
+                stopBlinkTimer();
+            else if ((fp_indicator >= 0) && (fp_indicator < FRONT_PANEL_INDICATOR_ALL))
+                stopBlink(indicatorNames[fp_indicator]);
+        }
+
+        // Builds the indicator table exactly once, no matter how many threads get here. A DS
+        // exception leaves the flag unset and is passed on, so a later call tries again.
+        void CFrontPanel::buildIndicatorTable()
+        {
+            std::call_once(m_indicatorsOnce, &CFrontPanel::loadIndicatorTable, this);
+        }
+
+        // Reads the indicator table from the DS front panel configuration. Everything about an
+        // indicator that DS can tell up front is resolved here, so the other operations neither
+        // look indicators up by name nor ask DS again.
+        void CFrontPanel::loadIndicatorTable()
+        {
+            std::vector<FrontPanelIndicatorEntry> table;
+            device::List <device::FrontPanelIndicator> fpIndicators = device::FrontPanelConfig::getInstance().getIndicators();
+            table.reserve(fpIndicators.size());
+            for (uint i = 0; i < fpIndicators.size(); i++)
+            {
+                std::string name = fpIndicators.at(i).getName();
+                bool duplicate = false;
+                for (size_t j = 0; (j < table.size()) && !duplicate; j++)
+                    duplicate = (table[j].name == name);
+                if (duplicate)
+                    continue;
+
+                FrontPanelIndicatorEntry entry;
+                entry.handle = &device::FrontPanelIndicator::getInstance(name);
+                entry.id = FRONT_PANEL_INDICATOR_ALL;
+                for (int id = 0; id < FRONT_PANEL_INDICATOR_ALL; id++)
+                {
+                    if (name == indicatorNames[id])
+                        entry.id = static_cast<frontPanelIndicator>(id);
+                }
+                entry.maxBrightness = entry.handle->getMaxBrightness();
+                entry.colorMode = entry.handle->getColorMode();
+                device::List <device::FrontPanelIndicator::Color> colors = entry.handle->getSupportedColors();
+                for (uint color = 0; color < colors.size(); color++)
+                    entry.supportedColors.push_back(colors.at(color).getId());
+                entry.name = std::move(name);
+                table.push_back(std::move(entry));
+            }
+
+            m_indicators.swap(table);
+            for (size_t i = 0; i < m_indicators.size(); i++)
+            {
+                if (m_indicators[i].id != FRONT_PANEL_INDICATOR_ALL)
+                    m_indicatorsById[m_indicators[i].id] = &m_indicators[i];
+            }
+            LOGINFO("Front panel has %zu indicators", m_indicators.size());
+        }
+
+        const FrontPanelIndicatorEntry* CFrontPanel::indicatorEntry(const std::string& ledIndicator)
+        {
+            for (size_t i = 0; i < m_indicators.size(); i++)
+            {
+                if (m_indicators[i].name == ledIndicator)
+                    return &m_indicators[i];
+            }
+            return nullptr;
+        }
+
+        // Indicators missing from the table are left to DS, which throws for an unknown name
+        // just like before the table existed.
+        device::FrontPanelIndicator& CFrontPanel::indicatorHandle(const std::string& ledIndicator)
+        {
+            const FrontPanelIndicatorEntry* entry = indicatorEntry(ledIndicator);
+            return (entry != nullptr) ? *entry->handle : device::FrontPanelIndicator::getInstance(ledIndicator.c_str());
+        }
+
+        device::FrontPanelIndicator& CFrontPanel::indicatorHandle(frontPanelIndicator fp_indicator)
+        {
+            const FrontPanelIndicatorEntry* entry = m_indicatorsById[fp_indicator];
+            return (entry != nullptr) ? *entry->handle : device::FrontPanelIndicator::getInstance(indicatorNames[fp_indicator]);
+        }
+
+        // Called with m_shadowMutex held.
+        FrontPanelShadowState& CFrontPanel::shadowState(device::FrontPanelIndicator& indicator)
+        {
+            for (size_t i = 0; i < m_shadowStates.size(); i++)
+            {
+                if (m_shadowStates[i].indicator == &indicator)
+                    return m_shadowStates[i];
+            }
+            m_shadowStates.push_back(FrontPanelShadowState());
+            m_shadowStates.back().indicator = &indicator;
+            return m_shadowStates.back();
+        }
+
+        void CFrontPanel::writeColor(device::FrontPanelIndicator& indicator, unsigned int color, bool persist)
+        {
+            std::lock_guard<std::mutex> lock(m_shadowMutex);
+            updateColor(shadowState(indicator), 1, color, persist);
+        }
+
+        void CFrontPanel::writeColorId(device::FrontPanelIndicator& indicator, int colorId, bool persist)
+        {
+            std::lock_guard<std::mutex> lock(m_shadowMutex);
+            updateColor(shadowState(indicator), 2, static_cast<unsigned int>(colorId), persist);
+        }
+
+        void CFrontPanel::writeBrightness(device::FrontPanelIndicator& indicator, int brightness, bool persist)
+        {
+            std::lock_guard<std::mutex> lock(m_shadowMutex);
+            updateBrightness(shadowState(indicator), brightness, persist);
+        }
+
+        void CFrontPanel::writeState(device::FrontPanelIndicator& indicator, bool state)
+        {
+            std::lock_guard<std::mutex> lock(m_shadowMutex);
+            updateState(shadowState(indicator), state);
+        }
+
+        // The update* functions are called with m_shadowMutex held. They skip the DS call when
+        // the shadow state says the indicator has the value already (and it was persisted, if
+        // asked to). A write that throws leaves the value unknown, so the next one goes to
+        // dsMgr again.
+        void CFrontPanel::updateColor(FrontPanelShadowState& shadow, int colorMode, unsigned int color, bool persist)
+        {
+            if (shadow.colorValid && (shadow.colorMode == colorMode) && (shadow.color == color) && (!persist || shadow.colorPersisted))
+            {
+                m_shadowHits++;
+                return;
+            }
+            m_shadowMisses++;
+            shadow.colorValid = false;
+            if (colorMode == 1)
+                shadow.indicator->setColor(color, persist);
+            else
+                shadow.indicator->setColor(device::FrontPanelIndicator::Color::getInstance(static_cast<int>(color)), persist);
+            shadow.colorMode = colorMode;
+            shadow.color = color;
+            shadow.colorPersisted = persist;
+            shadow.colorValid = true;
+        }
+
+        void CFrontPanel::updateBrightness(FrontPanelShadowState& shadow, int brightness, bool persist)
+        {
+            if (shadow.brightnessValid && (shadow.brightness == brightness) && (!persist || shadow.brightnessPersisted))
+            {
+                m_shadowHits++;
+                return;
+            }
+            m_shadowMisses++;
+            shadow.brightnessValid = false;
+            shadow.indicator->setBrightness(brightness, persist);
+            shadow.brightness = brightness;
+            shadow.brightnessPersisted = persist;
+            shadow.brightnessValid = true;
+        }
+
+        void CFrontPanel::updateState(FrontPanelShadowState& shadow, bool state)
+        {
+            if (shadow.stateValid && (shadow.state == state))
+            {
+                m_shadowHits++;
+                return;
+            }
+            m_shadowMisses++;
+            shadow.stateValid = false;
+            shadow.indicator->setState(state);
+            shadow.state = state;
+            shadow.stateValid = true;
+        }
+
+        void CFrontPanel::invalidateShadowStates()
+        {
+            std::lock_guard<std::mutex> lock(m_shadowMutex);
+            for (size_t i = 0; i < m_shadowStates.size(); i++)
+            {
+                m_shadowStates[i].colorValid = false;
+                m_shadowStates[i].brightnessValid = false;
+                m_shadowStates[i].stateValid = false;
+            }
+        }
+
+        void CFrontPanel::getShadowStatistics(uint64_t& hits, uint64_t& misses)
+        {
+            std::lock_guard<std::mutex> lock(m_shadowMutex);
+            hits = m_shadowHits;
+            misses = m_shadowMisses;
+        }
+
+        void CFrontPanel::setBlinkLed(const FrontPanelAnimationStep& step)
         {
-            std::string ledIndicator = blinkInfo.ledIndicator;
-            int brightness = blinkInfo.brightness;
             try
             {
-                if (blinkInfo.colorMode == 1)
+                if (step.colorMode == 1)
                 {
-                    device::FrontPanelIndicator::getInstance(ledIndicator.c_str()).setColor(blinkInfo.colorValue, false);
+                    writeColor(*step.indicator, step.colorValue, false);
                 }
-                else if (blinkInfo.colorMode == 2)
+                else if (step.colorMode == 2)
                 {
-                    device::FrontPanelIndicator::getInstance(ledIndicator.c_str()).setColor(device::FrontPanelIndicator::Color::getInstance(blinkInfo.colorName.c_str()), false);
+                    writeColorId(*step.indicator, step.colorId, false);
                 }
 
             }
@@ -580,10 +1050,7 @@ namespace WPEFramework
             {}
             try
             {
-                if (brightness == -1)
-                    brightness = device::FrontPanelIndicator::getInstance(ledIndicator.c_str()).getBrightness(true);
-
-                device::FrontPanelIndicator::getInstance(ledIndicator.c_str()).setBrightness(brightness, false);
+                writeBrightness(*step.indicator, step.brightness, false);
             }
             catch (...)
             {
@@ -591,29 +1058,43 @@ namespace WPEFramework
             }
         }
 
+        // Advances every slot that is due and schedules the timer for the next one.
         void CFrontPanel::onBlinkTimer()
         {
-            m_currentBlinkListIndex++;
-            bool blinkAgain = true;
-            if ((size_t)m_currentBlinkListIndex >= m_blinkList.size())
+            std::lock_guard<std::mutex> lock(m_blinkMutex);
+            uint64_t now = Core::Time::Now().Ticks();
+            for (size_t i = 0; i < m_blinkSlots.size(); i++)
             {
-                blinkAgain = false;
-                m_currentBlinkListIndex = 0;
-                m_numberOfBlinks++;
-                if (m_maxNumberOfBlinkRepeats < 0 || m_numberOfBlinks <= m_maxNumberOfBlinkRepeats)
+                FrontPanelBlinkSlot& slot = m_blinkSlots[i];
+                if (!slot.active || (slot.due > now))
+                    continue;
+
+                slot.currentStep++;
+                bool blinkAgain = true;
+                if (slot.currentStep >= slot.steps.size())
                 {
-                    blinkAgain = true;
+                    blinkAgain = false;
+                    slot.currentStep = 0;
+                    slot.numberOfBlinks++;
+                    if (slot.maxNumberOfBlinkRepeats < 0 || slot.numberOfBlinks <= slot.maxNumberOfBlinkRepeats)
+                    {
+                        blinkAgain = true;
+                    }
+                }
+                if (blinkAgain)
+                {
+                    const FrontPanelAnimationStep& step = slot.steps[slot.currentStep];
+                    setBlinkLed(step);
+                    // Steps follow on from the due time, so LEDs started together stay in step.
+                    slot.due = std::max(slot.due + stepTicks(step), now);
+                }
+                else
+                {
+                    //if not blink again then the led color should stay on the LAST element in the array as stated in the spec
+                    slot.active = false;
                 }
             }
-            if (blinkAgain)
-            {
-                FrontPanelBlinkInfo blinkInfo = m_blinkList.at(m_currentBlinkListIndex);
-                setBlinkLed(blinkInfo);
-                if (m_isBlinking)
-                    blinkTimer.Schedule(Core::Time::Now().Add(blinkInfo.durationInMs), m_blinkTimer);
-            }
-
-            //if not blink again then the led color should stay on the LAST element in the array as stated in the spec
+            scheduleBlinkTimer();
         }
 
         uint64_t BlinkInfo::Timed(const uint64_t scheduledTime)
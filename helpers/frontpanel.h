@@ -30,10 +30,16 @@
 
 #include <string>
 #include <list>
+#include <mutex>
 #include <vector>
 
 #include <plugins/plugins.h>
 
+namespace device
+{
+    class FrontPanelIndicator;
+}
+
 namespace WPEFramework
 {
 
@@ -81,8 +87,64 @@ namespace WPEFramework
             int brightness;
             int durationInMs;
             int colorMode;
+            bool fade;
         } FrontPanelBlinkInfo;
 
+        // One step of a compiled blink pattern, see CFrontPanel::compileBlink. Indicator and
+        // color are resolved and the brightness is final, so a step is applied without any
+        // lookup by name. A fading pattern entry is compiled into one step per frame.
+        typedef struct _FrontPanelAnimationStep
+        {
+            device::FrontPanelIndicator* indicator;
+            unsigned int colorValue; // color mode 1
+            int colorId;             // color mode 2
+            int colorMode;
+            int brightness;
+            int durationInMs;
+        } FrontPanelAnimationStep;
+
+        // Blink pattern running on one indicator. Every indicator has its own slot, all of
+        // them are advanced by the one blink timer, see CFrontPanel::onBlinkTimer.
+        typedef struct _FrontPanelBlinkSlot
+        {
+            std::string ledIndicator;
+            std::vector<FrontPanelAnimationStep> steps;
+            size_t currentStep;
+            int numberOfBlinks;
+            int maxNumberOfBlinkRepeats;
+            uint64_t due; // Core::Time ticks of the next step
+            bool active;
+        } FrontPanelBlinkSlot;
+
+        // Last value written to an indicator through CFrontPanel, used to skip writes that
+        // would not change anything. color is the RGB value in color mode 1, the DS color id
+        // in color mode 2.
+        typedef struct _FrontPanelShadowState
+        {
+            device::FrontPanelIndicator* indicator;
+            bool colorValid;
+            bool colorPersisted;
+            int colorMode;
+            unsigned int color;
+            bool brightnessValid;
+            bool brightnessPersisted;
+            int brightness;
+            bool stateValid;
+            bool state;
+        } FrontPanelShadowState;
+
+        // Target state of one indicator in CFrontPanel::applyTransaction. -1 (colorMode 0)
+        // leaves the setting as it is.
+        typedef struct _FrontPanelIndicatorState
+        {
+            std::string ledIndicator;
+            int state;      // 1 on, 0 off
+            int brightness;
+            int colorMode;  // 1 colorValue, 2 colorName
+            unsigned int colorValue;
+            std::string colorName;
+        } FrontPanelIndicatorState;
+
         typedef enum _frontPanelIndicator
         {
             FRONT_PANEL_INDICATOR_CLOCK,
@@ -94,6 +156,17 @@ namespace WPEFramework
             FRONT_PANEL_INDICATOR_ALL
         } frontPanelIndicator;
 
+        // One indicator of the front panel configuration, see CFrontPanel::buildIndicatorTable.
+        typedef struct _FrontPanelIndicatorEntry
+        {
+            frontPanelIndicator id; // FRONT_PANEL_INDICATOR_ALL if it has no enum value
+            std::string name;
+            device::FrontPanelIndicator* handle;
+            int maxBrightness;
+            int colorMode;
+            std::vector<int> supportedColors; // DS color ids
+        } FrontPanelIndicatorEntry;
+
         class CFrontPanel
         {
         public:
@@ -113,8 +186,12 @@ namespace WPEFramework
             void setPowerStatus(bool powerStatus);
             bool setLED(const JsonObject& blinkInfo);
             void setBlink(const JsonObject& blinkInfo);
+            bool applyTransaction(const JsonObject& parameters);
+            bool applyTransaction(const std::vector<FrontPanelIndicatorState>& states);
             void loadPreferences();
             void stopBlinkTimer();
+            void stopBlink(const std::string& ledIndicator);
+            void getShadowStatistics(uint64_t& hits, uint64_t& misses);
 
             void onBlinkTimer();
             static int initDone;
@@ -122,13 +199,42 @@ namespace WPEFramework
         private:
             CFrontPanel();
             static CFrontPanel* s_instance;
-            void startBlinkTimer(int numberOfBlinkRepeats);
-            void setBlinkLed(FrontPanelBlinkInfo blinkInfo);
+            void startBlinkTimer(FrontPanelBlinkSlot& slot, int numberOfBlinkRepeats);
+            void scheduleBlinkTimer();
+            void stopIndicatorBlink(frontPanelIndicator fp_indicator);
+            bool compileBlink(const std::vector<FrontPanelBlinkInfo>& blinkList, int frameRate, std::vector<FrontPanelAnimationStep>& animation);
+            void setBlinkLed(const FrontPanelAnimationStep& step);
+            void buildIndicatorTable();
+            void loadIndicatorTable();
+            const FrontPanelIndicatorEntry* indicatorEntry(const std::string& ledIndicator);
+            device::FrontPanelIndicator& indicatorHandle(const std::string& ledIndicator);
+            device::FrontPanelIndicator& indicatorHandle(frontPanelIndicator fp_indicator);
+            FrontPanelShadowState& shadowState(device::FrontPanelIndicator& indicator);
+            void writeColor(device::FrontPanelIndicator& indicator, unsigned int color, bool persist);
+            void writeColorId(device::FrontPanelIndicator& indicator, int colorId, bool persist);
+            void writeBrightness(device::FrontPanelIndicator& indicator, int brightness, bool persist);
+            void writeState(device::FrontPanelIndicator& indicator, bool state);
+            void updateColor(FrontPanelShadowState& shadow, int colorMode, unsigned int color, bool persist);
+            void updateBrightness(FrontPanelShadowState& shadow, int brightness, bool persist);
+            void updateState(FrontPanelShadowState& shadow, bool state);
+            void invalidateShadowStates();
             JsonObject m_preferencesHash;  // is this needed
 
+            // Indicators of the panel, built once when DS is up and not changed afterwards.
+            // m_indicatorsById maps the frontPanelIndicator values into it (null: not present).
+            std::once_flag m_indicatorsOnce;
+            std::vector<FrontPanelIndicatorEntry> m_indicators;
+            const FrontPanelIndicatorEntry* m_indicatorsById[FRONT_PANEL_INDICATOR_ALL];
+
             BlinkInfo m_blinkTimer;
-            bool m_isBlinking;
-            std::vector<FrontPanelBlinkInfo> m_blinkList;
+            std::mutex m_blinkMutex;
+            std::vector<FrontPanelBlinkSlot> m_blinkSlots;
+            // Shadow state of every indicator written so far, with the number of writes it
+            // saved (hits) and passed on to dsMgr (misses).
+            std::mutex m_shadowMutex;
+            std::vector<FrontPanelShadowState> m_shadowStates;
+            uint64_t m_shadowHits;
+            uint64_t m_shadowMisses;
             std::list<FrontPanelImplementation*> observers_;
 
             std::string lastError_;
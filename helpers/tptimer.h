@@ -22,6 +22,7 @@
 
 //#include <core/Timer.h>
 #include <plugins/plugins.h>
+#include <mutex>
 
 namespace WPEFramework {
 
@@ -34,12 +35,14 @@ namespace Plugin {
             TpTimerJob& operator=(const TpTimerJob& RHS) = delete;
 
         public:
-            TpTimerJob(TpTimer* tpt)
+            TpTimerJob(TpTimer* tpt, uint32_t generation)
                 : m_tptimer(tpt)
+                , m_generation(generation)
             {
             }
             TpTimerJob(const TpTimerJob& copy)
                 : m_tptimer(copy.m_tptimer)
+                , m_generation(copy.m_generation)
             {
             }
             ~TpTimerJob() {}
@@ -53,55 +56,72 @@ namespace Plugin {
             uint64_t Timed(const uint64_t scheduledTime)
             {
                 if (m_tptimer) {
-                    m_tptimer->Timed();
+                    m_tptimer->Timed(m_generation);
                 }
                 return 0;
             }
 
         private:
             TpTimer* m_tptimer;
+            uint32_t m_generation;
         };
 
     public:
         TpTimer()
             : baseTimer(64 * 1024, "ThunderPluginBaseTimer")
-            , m_timerJob(this)
+            , m_timerJob(this, 0)
             , m_isActive(false)
             , m_isSingleShot(false)
             , m_intervalInMs(-1)
+            , m_generation(0)
         {
         }
         ~TpTimer()
         {
             stop();
+            baseTimer.Revoke(m_timerJob);
         }
 
         bool isActive()
         {
+            std::lock_guard<std::mutex> lock(m_lock);
             return m_isActive;
         }
+        // Does not wait for a callback that is already running.
         void stop()
         {
-            baseTimer.Revoke(m_timerJob);
+            std::lock_guard<std::mutex> lock(m_lock);
             m_isActive = false;
+            m_generation++;
         }
         void start()
         {
-            baseTimer.Revoke(m_timerJob);
-            baseTimer.Schedule(Core::Time::Now().Add(m_intervalInMs), m_timerJob);
-            m_isActive = true;
+            uint32_t generation;
+            int interval;
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                m_isActive = true;
+                generation = ++m_generation;
+                interval = m_intervalInMs;
+            }
+            schedule(generation, interval);
         }
         void start(int msec)
         {
-            setInterval(msec);
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                m_intervalInMs = msec;
+            }
             start();
         }
         void setSingleShot(bool val)
         {
+            std::lock_guard<std::mutex> lock(m_lock);
             m_isSingleShot = val;
         }
         void setInterval(int msec)
         {
+            std::lock_guard<std::mutex> lock(m_lock);
             m_intervalInMs = msec;
         }
 
@@ -111,19 +131,39 @@ namespace Plugin {
         }
 
     private:
-        void Timed()
+        // Never called with m_lock held. Jobs are not revoked when the timer is stopped or
+        // started again, a job of an older generation just does nothing when it fires.
+        void schedule(uint32_t generation, int interval)
+        {
+            baseTimer.Schedule(Core::Time::Now().Add(interval), TpTimerJob(this, generation));
+        }
+
+        void Timed(uint32_t generation)
         {
+            {
+                // A single shot timer is done once it fired, its callback may start it again.
+                std::lock_guard<std::mutex> lock(m_lock);
+                if (!m_isActive || (generation != m_generation)) {
+                    return; // stopped or started again since
+                }
+                if (m_isSingleShot) {
+                    m_isActive = false;
+                }
+            }
+
             if (onTimeoutCallback != nullptr) {
                 onTimeoutCallback();
             }
 
-            if (m_isActive) {
-                if (m_isSingleShot) {
-                    stop();
-                } else {
-                    start();
+            int interval;
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                if (!m_isActive || m_isSingleShot || (generation != m_generation)) {
+                    return;
                 }
+                interval = m_intervalInMs;
             }
+            schedule(generation, interval);
         }
 
         WPEFramework::Core::TimerType<TpTimerJob> baseTimer;
@@ -131,6 +171,10 @@ namespace Plugin {
         bool m_isActive;
         bool m_isSingleShot;
         int m_intervalInMs;
+        // Bumped by start() and stop(), see schedule().
+        uint32_t m_generation;
+        // start() and stop() are called from any thread, Timed() from the timer thread.
+        std::mutex m_lock;
 
         std::function<void()> onTimeoutCallback;
     };